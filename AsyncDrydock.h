@@ -0,0 +1,421 @@
+#pragma once
+
+/*
+	Coroutine-based asynchronous Drydock
+
+	Notes:
+		Hierarchical timer wheel, single-threaded event loop, and a Drydock whose builds and launches take simulated time
+		The event loop and the Drydock need C++20 coroutines; FSM_COROUTINES is 0 and only the timer wheel is defined when the
+		compiler has none
+*/
+
+#include "FSM.h"
+#include <utility>
+#include <exception>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define FSM_COROUTINES 1
+#else
+#define FSM_COROUTINES 0
+#endif
+
+#pragma region Timer wheel
+//Hierarchical timer wheel in the style of Varghese and Lauck: (levelCount) levels of (slotCount) slots, where level L
+//slots are slotCount^L ticks wide, so timers of any delay are scheduled in O(1) and cascade down a level at a time as
+//they come due; a bitmap of the occupied slots of each level lets time jump straight to the next tick that has timers
+//due or to cascade, however far away it is
+//Each slot is an array of its timers, so scheduling, cascading and firing all walk memory in order; slots keep their
+//capacity once emptied, so a wheel with a steady number of timers stops allocating
+//Used by EventLoop for suspended coroutines and by ShipyardSimulator for its arrival processes
+	//(Payload) value carried by a timer and passed back when it fires, e.g. a coroutine handle or an index
+template<class Payload> class TimerWheel
+{
+private:
+	static constexpr unsigned slotBits = 8;
+	static constexpr unsigned slotCount = 1 << slotBits;
+	static constexpr unsigned long long slotMask = slotCount - 1;
+	static constexpr unsigned levelCount = 64 / slotBits; //enough levels for any 64-bit deadline
+	static constexpr size_t prefetchDistance = 4; //timers ahead of the one firing that are passed to the prefetch hook
+
+	struct Timer
+	{
+		unsigned long long deadline;
+		Payload payload;
+	};
+
+	std::vector<Timer> slots[levelCount][slotCount];
+	std::vector<Timer> detached; //slot being cascaded or fired
+	unsigned long long occupied[levelCount][slotCount / 64] = {}; //slots of each level that hold timers
+	unsigned long long now = 0;
+	unsigned long long pending = 0;
+
+	//Returns the next tick after the current one that has level 0 timers due or a slot to cascade down
+	//A level's occupied slots all lie after the current tick's slot of that level, so the earliest is the first occupied
+	//slot of the lowest level that has one; the time before it holds nothing to do
+	unsigned long long nextTick(void)
+	{
+		for (unsigned level = 0; level < levelCount; level++)
+		{
+			unsigned shift = level * slotBits;
+			unsigned index = this->nextOccupied(level, unsigned((this->now >> shift) & slotMask) + 1);
+			if (index == slotCount) continue;
+			unsigned long long span = shift + slotBits < 64 ? ~0ull << (shift + slotBits) : 0; //bits above this level
+			return (this->now & span) + ((unsigned long long)index << shift);
+		}
+		return ~0ull;
+	}
+
+	//Returns the index of the lowest set bit of a non-zero value
+	static int lowestBit(unsigned long long value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return int(index);
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+	//Adds a timer to the slot of the lowest level whose span still holds its deadline
+	//Parametres:
+		//(timer) timer to add
+	void link(const Timer& timer)
+	{
+		unsigned long long differing = timer.deadline ^ this->now;
+		unsigned level = differing ? unsigned(LatencyHistogram::highestBit(differing)) / slotBits : 0;
+		unsigned index = unsigned((timer.deadline >> (level * slotBits)) & slotMask);
+		this->slots[level][index].push_back(timer);
+		this->occupied[level][index / 64] |= 1ull << (index % 64);
+	}
+
+	//Moves the timers of a slot to the detached list, leaving the slot empty
+	//Parametres:
+		//(level) level of the slot
+		//(index) index of the slot within its level
+	void detach(unsigned level, unsigned index)
+	{
+		this->detached.clear();
+		this->detached.swap(this->slots[level][index]);
+		this->occupied[level][index / 64] &= ~(1ull << (index % 64));
+	}
+
+	//Returns the first slot of a level at or after an index that holds timers, or slotCount if there is none
+	//Parametres:
+		//(level) level to look at
+		//(from) first slot index to look at
+	unsigned nextOccupied(unsigned level, unsigned from)
+	{
+		for (unsigned word = from / 64; word < slotCount / 64; word++)
+		{
+			unsigned long long bits = this->occupied[level][word];
+			if (word == from / 64) bits &= ~0ull << (from % 64);
+			if (bits) return word * 64 + unsigned(lowestBit(bits));
+		}
+		return slotCount;
+	}
+public:
+	//Prefetch hook of advance() that does nothing
+	struct NoPrefetch
+	{
+		void operator()(const Payload& payload) const {}
+	};
+
+	//Schedules a timer
+	//Parametres:
+		//(payload) value passed back when the timer fires
+		//(delay) ticks until the timer is due; delays of 0 are rounded up to 1
+	void schedule(const Payload& payload, unsigned long long delay)
+	{
+		this->link({ this->now + (delay ? delay : 1), payload });
+		this->pending++;
+	}
+
+	//Moves to the next tick that has timers due, up to a limit, and fires them in the order they were scheduled
+	//Ticks with nothing due are jumped over, a level at a time at worst; a fired timer may be scheduled again
+	//Returns false, with the time moved to the limit, if no timer is due up to and including the limit
+	//Parametres:
+		//(limit) last tick to move to
+		//(fire) called with the payload of each timer due
+		//(prefetch) called with the payload of a timer a few timers before it fires, so the data it needs can be loaded early
+	template<class Fire, class Prefetch = NoPrefetch> bool advance(unsigned long long limit, Fire fire, Prefetch prefetch = Prefetch())
+	{
+		while (this->now < limit)
+		{
+			if (this->pending == 0)
+			{
+				this->now = limit;
+				return false;
+			}
+
+			//the next timer is either later in this lap of level 0, or cascades down from the first occupied higher slot
+			unsigned long long tick = this->nextTick();
+			if (tick > limit)
+			{
+				this->now = limit; //nothing is due or cascades between now and the limit
+				return false;
+			}
+			this->now = tick;
+
+			//cascade the slots that start at this tick, highest level first so timers can fall more than one level
+			//(the lower levels' slots passed over on the way were empty)
+			if ((tick & slotMask) == 0)
+			{
+				for (unsigned level = levelCount - 1; level > 0; level--)
+				{
+					if (tick & ((1ull << (level * slotBits)) - 1)) continue;
+					this->detach(level, unsigned((tick >> (level * slotBits)) & slotMask));
+					for (const Timer& timer : this->detached) this->link(timer);
+				}
+			}
+
+			//timers scheduled while these fire are due later, so they never land in the detached slot
+			this->detach(0, unsigned(tick & slotMask));
+			if (this->detached.empty()) continue;
+			size_t count = this->detached.size();
+			this->pending -= count;
+			for (size_t i = 0; i < count; i++)
+			{
+				if (i + prefetchDistance < count) prefetch(this->detached[i + prefetchDistance].payload);
+				fire(this->detached[i].payload);
+			}
+			return true;
+		}
+		return false;
+	}
+
+	//Removes every timer, appending its payload to a list
+	//Parametres:
+		//(payloads) list to append to
+	void drain(std::vector<Payload>& payloads)
+	{
+		for (unsigned level = 0; level < levelCount; level++)
+		{
+			for (unsigned index = 0; index < slotCount; index++)
+			{
+				for (const Timer& timer : this->slots[level][index]) payloads.push_back(timer.payload);
+				this->slots[level][index].clear();
+			}
+		}
+		for (unsigned level = 0; level < levelCount; level++)
+		{
+			for (unsigned long long& word : this->occupied[level]) word = 0;
+		}
+		this->pending = 0;
+	}
+
+	//Returns the current tick
+	unsigned long long getTime(void) { return this->now; }
+
+	//Returns the number of timers scheduled
+	unsigned long long getPending(void) { return this->pending; }
+};
+#pragma endregion
+
+#if FSM_COROUTINES
+#pragma region Event loop
+class EventLoop;
+
+//Coroutine returned by a Drydock workflow, e.g. DrydockTask yard(AsyncDrydock& dock) { co_await dock.build(1); ... }
+//Created suspended and started by EventLoop::spawn(); its frame is freed as soon as it finishes
+class DrydockTask
+{
+public:
+	struct promise_type
+	{
+		EventLoop* loop = nullptr;
+
+		DrydockTask get_return_object(void) { return DrydockTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend(void) noexcept { return {}; }
+		std::suspend_never final_suspend(void) noexcept { return {}; }
+		void return_void(void);
+		void unhandled_exception(void) { std::terminate(); }
+	};
+private:
+	std::coroutine_handle<promise_type> handle;
+	friend class EventLoop;
+public:
+	explicit DrydockTask(std::coroutine_handle<promise_type> nHandle) { this->handle = nHandle; }
+	DrydockTask(DrydockTask&& other) noexcept { this->handle = std::exchange(other.handle, nullptr); }
+	DrydockTask(const DrydockTask&) = delete;
+	DrydockTask& operator=(const DrydockTask&) = delete;
+
+	//Destroys the coroutine if it was never spawned
+	~DrydockTask(void)
+	{
+		if (this->handle) this->handle.destroy();
+	}
+};
+
+//Single-threaded loop that runs DrydockTasks in simulated time
+//Tasks that are ready run in the order they became ready; when none are, time jumps to the next tick a timer is due
+//on, so a single thread can keep any number of Drydocks in flight and idle stretches cost nothing
+class EventLoop
+{
+private:
+	TimerWheel<std::coroutine_handle<>> timers;
+	std::vector<std::coroutine_handle<>> ready;
+	std::vector<std::coroutine_handle<>> running;
+	unsigned long long liveTasks = 0;
+	unsigned long long peakTasks = 0;
+	unsigned long long resumes = 0;
+public:
+	//Awaitable that resumes the awaiting coroutine after a number of ticks
+	struct Delay
+	{
+		EventLoop* loop;
+		unsigned long long ticks;
+		bool await_ready(void) const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> handle) { this->loop->schedule(handle, this->ticks); }
+		void await_resume(void) const noexcept {}
+	};
+
+	EventLoop(void) {}
+
+	//Destroys the coroutines that have not finished
+	~EventLoop(void)
+	{
+		this->timers.drain(this->ready);
+		for (std::coroutine_handle<> handle : this->ready) handle.destroy();
+	}
+
+	EventLoop(const EventLoop&) = delete;
+	EventLoop& operator=(const EventLoop&) = delete;
+
+	//Starts a task on the next run of the loop; the loop takes ownership of it
+	//Parametres:
+		//(task) task returned by a workflow coroutine
+	void spawn(DrydockTask task)
+	{
+		task.handle.promise().loop = this;
+		this->ready.push_back(std::exchange(task.handle, nullptr));
+		this->peakTasks = std::max(this->peakTasks, ++this->liveTasks);
+	}
+
+	//Resumes a suspended coroutine after a delay
+	//Parametres:
+		//(handle) suspended coroutine
+		//(delay) ticks to wait; 0 resumes it on this tick, after the coroutines that are already ready
+	void schedule(std::coroutine_handle<> handle, unsigned long long delay)
+	{
+		if (delay == 0) this->ready.push_back(handle);
+		else this->timers.schedule(handle, delay);
+	}
+
+	//Returns an awaitable that resumes the awaiting coroutine after a number of ticks
+	//Parametres:
+		//(ticks) ticks to wait
+	Delay sleep(unsigned long long ticks) { return { this, ticks }; }
+
+	//Runs until every task has finished, or until a time limit, and returns the tick it stopped on
+	//Parametres:
+		//(limit) last tick to run; tasks due later stay suspended, and a later run carries on from the limit
+	unsigned long long run(unsigned long long limit = ~0ull)
+	{
+		while (true)
+		{
+			while (!this->ready.empty())
+			{
+				this->running.swap(this->ready);
+				for (std::coroutine_handle<> handle : this->running) handle.resume();
+				this->resumes += this->running.size();
+				this->running.clear();
+			}
+			if (this->timers.getPending() == 0) return this->timers.getTime();
+			if (!this->timers.advance(limit, [this](std::coroutine_handle<> handle) { this->ready.push_back(handle); })) return this->timers.getTime();
+		}
+	}
+
+	//Counts a finished task (called by DrydockTask's promise)
+	void finished(void) { this->liveTasks--; }
+
+	//Returns the current simulated tick
+	unsigned long long getTime(void) { return this->timers.getTime(); }
+
+	//Returns the number of tasks spawned that have not finished
+	unsigned long long getLiveTasks(void) { return this->liveTasks; }
+
+	//Returns the largest number of tasks that were in flight at once
+	unsigned long long getPeakTasks(void) { return this->peakTasks; }
+
+	//Returns the number of times a coroutine was resumed
+	unsigned long long getResumes(void) { return this->resumes; }
+};
+
+inline void DrydockTask::promise_type::return_void(void) { this->loop->finished(); }
+#pragma endregion
+
+#pragma region Asynchronous Drydock
+//Drydock driven by coroutines on an EventLoop, where constructing and launching a ship take simulated time
+//The wrapped Drydock and its state classes decide every event; the awaitables only add the delays, so a build or
+//launch the Drydock rejects completes at once without suspending
+class AsyncDrydock
+{
+private:
+	EventLoop* loop;
+	Drydock drydock;
+	unsigned buildTicks;
+	unsigned launchTicks;
+public:
+	//Awaitable returned by build(); resumes with whether the selection was accepted
+	struct BuildAwaiter
+	{
+		EventLoop* loop;
+		unsigned ticks;
+		bool accepted;
+		bool await_ready(void) const noexcept { return !this->accepted; }
+		void await_suspend(std::coroutine_handle<> handle) { this->loop->schedule(handle, this->ticks); }
+		bool await_resume(void) const noexcept { return this->accepted; }
+	};
+
+	//Awaitable returned by launch(); resumes with the undocked ship, or an empty handle
+	struct LaunchAwaiter
+	{
+		AsyncDrydock* dock;
+		bool launching;
+		bool await_ready(void) const noexcept { return !this->launching; }
+		void await_suspend(std::coroutine_handle<> handle) { this->dock->loop->schedule(handle, this->dock->launchTicks); }
+		ShipHandle await_resume(void)
+		{
+			if (!this->launching || !this->dock->drydock.launch()) return nullptr;
+			return this->dock->drydock.undockShip();
+		}
+	};
+
+	//Parametres:
+		//(nLoop) event loop the Drydock's coroutines run on
+		//(nBuildTicks) ticks taken to construct a ship
+		//(nLaunchTicks) ticks taken to launch a ship
+	AsyncDrydock(EventLoop& nLoop, unsigned nBuildTicks = 60, unsigned nLaunchTicks = 10)
+	{
+		this->loop = &nLoop;
+		this->buildTicks = nBuildTicks;
+		this->launchTicks = nLaunchTicks;
+	}
+
+	//Supplies components at once
+	//Parametres:
+		//(components) amount of components to supply
+	bool supplyComponents(int components) { return this->drydock.supplyComponents(components); }
+
+	//Transfers energy at once
+	//Parametres:
+		//(energy) energy to be transferred to power the Drydock
+	bool transferEnergy(int energy) { return this->drydock.transferEnergy(energy); }
+
+	//Selects a ship configuration and constructs it; use as co_await dock.build(option)
+	//The selection is made when build() is called, and the awaiting coroutine resumes after the build time
+	//Parametres:
+		//(option) selection value to indicate the ship configuration desired
+	BuildAwaiter build(int option) { return { this->loop, this->buildTicks, this->drydock.makeSelection(option) }; }
+
+	//Launches and undocks the constructed ship; use as co_await dock.launch()
+	//The awaiting coroutine resumes after the launch time, when the Drydock launches the ship
+	LaunchAwaiter launch(void) { return { this, this->drydock.getState() == Launching_Ship }; }
+
+	//Returns the wrapped Drydock
+	Drydock& getDrydock(void) { return this->drydock; }
+};
+#pragma endregion
+#endif
@@ -0,0 +1,1098 @@
+/*
+	Drydock benchmarks
+
+	Notes:
+		Built as the fsm_benchmark target; prints ns/event of every Drydock implementation and the component,
+		planner, journal, replay, input parsing and shipyard simulation figures, then runs the micro-benchmark suite
+		(run with --json for JSON output, or --simulate for only a 10^8 event shipyard simulation)
+*/
+
+#include "Utility.h"
+#include "FSM.h"
+#include "Diagnostics.h"
+#include "Engines.h"
+#include "AsyncDrydock.h"
+#include "Simulator.h"
+#include <functional>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+#include <fcntl.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#pragma region Allocation counting
+//Global heap allocations made by the process, counted by the replacement operator new below
+static atomic<unsigned long long> heapAllocations(0);
+
+void* operator new(size_t size)
+{
+	heapAllocations.fetch_add(1, memory_order_relaxed);
+	if (void* block = malloc(size ? size : 1)) return block;
+	throw bad_alloc();
+}
+void operator delete(void* block) noexcept { free(block); }
+void operator delete(void* block, size_t) noexcept { free(block); }
+
+//Over-aligned types (such as StateContext) are allocated through these
+void* operator new(size_t size, align_val_t alignment)
+{
+	heapAllocations.fetch_add(1, memory_order_relaxed);
+	size_t align = size_t(alignment);
+	size_t rounded = (max(size, size_t(1)) + align - 1) / align * align;
+#ifdef _WIN32
+	if (void* block = _aligned_malloc(rounded, align)) return block;
+#else
+	if (void* block = aligned_alloc(align, rounded)) return block;
+#endif
+	throw bad_alloc();
+}
+#ifdef _WIN32
+void operator delete(void* block, align_val_t) noexcept { _aligned_free(block); }
+void operator delete(void* block, size_t, align_val_t) noexcept { _aligned_free(block); }
+#else
+void operator delete(void* block, align_val_t) noexcept { free(block); }
+void operator delete(void* block, size_t, align_val_t) noexcept { free(block); }
+#endif
+#pragma endregion
+
+#pragma region Benchmarks
+//Micro-benchmark comparing the Drydock implementations in ns/event
+//Built as the fsm_benchmark target
+class DrydockBenchmark
+{
+private:
+	DrydockBenchmark() {}; //prevents class from being constructed
+
+	//Builds a repeating stream of build cycles with a mix of accepted and rejected events
+	//Parametres:
+		//(count) number of events in the stream
+	static vector<DrydockEvent> makeStream(unsigned count)
+	{
+		const DrydockEvent cycle[] = {
+			{ Supply_Components, 10 }, { Transfer_Energy, 20000 }, { Make_Selection, 1 + 128 }, { Launch_Ship, 0 },
+			{ Transfer_Energy, -1 }, { Make_Selection, 3 }, { Make_Selection, 64 + 8192 }, { Supply_Components, 5 },
+			{ Launch_Ship, 0 }, { Launch_Ship, 0 }, { Transfer_Energy, 5000 }, { Make_Selection, 16 } };
+		const unsigned cycleLength = sizeof(cycle) / sizeof(cycle[0]);
+
+		vector<DrydockEvent> stream;
+		stream.reserve(count);
+		for (unsigned i = 0; i < count; i++) stream.push_back(cycle[i % cycleLength]);
+		return stream;
+	}
+
+	//Releases a launched ship the same way DrydockUI does
+	static void release(Drydock& dock) { dock.undockShip(); }
+	static void release(StaticDrydock& dock) {}
+
+	//Drives a Drydock implementation through the stream and returns the average ns/event
+	//Parametres:
+		//(stream) events to apply
+		//(accepted) incremented by the number of accepted events
+	template<class Dock> static double time(const vector<DrydockEvent>& stream, unsigned& accepted)
+	{
+		Dock dock;
+		auto start = chrono::steady_clock::now();
+		for (const DrydockEvent& e : stream)
+		{
+			bool result = false;
+			switch (e.kind)
+			{
+			case Transfer_Energy: result = dock.transferEnergy(e.payload); break;
+			case Make_Selection: result = dock.makeSelection(e.payload); break;
+			case Supply_Components: result = dock.supplyComponents(e.payload); break;
+			case Launch_Ship:
+				result = dock.launch();
+				if (result) release(dock);
+				break;
+			}
+			accepted += result;
+		}
+		auto end = chrono::steady_clock::now();
+		return chrono::duration<double, nano>(end - start).count() / stream.size();
+	}
+	//Drives a TableDrydock through the stream, optionally recording every event in a journal, and returns the average ns/event
+	//The final flush and close of the journal are included in the time
+	//Parametres:
+		//(stream) events to apply
+		//(journalPath) journal file to write, or nullptr to run without a journal
+	static double timeJournal(const vector<DrydockEvent>& stream, const char* journalPath)
+	{
+		TableDrydock dock;
+		if (journalPath) dock.setJournal(new DrydockJournal(journalPath, 65536, stream.size()));
+		auto start = chrono::steady_clock::now();
+		for (const DrydockEvent& e : stream)
+		{
+			switch (e.kind)
+			{
+			case Transfer_Energy: dock.transferEnergy(e.payload); break;
+			case Make_Selection: dock.makeSelection(e.payload); break;
+			case Supply_Components: dock.supplyComponents(e.payload); break;
+			case Launch_Ship: if (dock.launch()) dock.undockShip(); break;
+			}
+		}
+		dock.setJournal(nullptr);
+		auto end = chrono::steady_clock::now();
+		return chrono::duration<double, nano>(end - start).count() / stream.size();
+	}
+
+	//Prints the per-event cost of journalling and checks the journal file holds every event
+	//Parametres:
+		//(stream) events to apply
+	static void runJournal(const vector<DrydockEvent>& stream)
+	{
+		const char* path = "drydock_benchmark.journal";
+		remove(path);
+		double plain = timeJournal(stream, nullptr);
+		double journalled = timeJournal(stream, path);
+
+		vector<JournalRecord> records;
+		DrydockJournal::load(path, records);
+		remove(path);
+		cout << "Journal: " << journalled - plain << " ns/event overhead (" << plain << " ns/event without, " << journalled << " with), "
+			<< records.size() << " records read back (events and undocks)" << endl;
+	}
+
+	//Prints the throughput of replaying a journal onto a snapshot and the time taken by a full recovery from files
+	//Parametres:
+		//(stream) events to journal
+		//(snapshotInterval) number of records between snapshots
+	static void runReplay(const vector<DrydockEvent>& stream, unsigned long long snapshotInterval)
+	{
+		const char* journalPath = "drydock_benchmark.journal";
+		const char* snapshotPath = "drydock_benchmark.snapshot";
+		remove(journalPath);
+		remove(snapshotPath);
+
+		DrydockSnapshot expected;
+		{
+			TableDrydock dock;
+			DrydockJournal* journal = new DrydockJournal(journalPath, 65536, stream.size());
+			journal->setSnapshots(snapshotPath, snapshotInterval);
+			dock.setJournal(journal);
+			for (const DrydockEvent& e : stream) if (dock.apply(e) && e.kind == Launch_Ship) dock.undockShip();
+			expected = dock.snapshot();
+		}
+
+		vector<JournalRecord> records;
+		DrydockJournal::load(journalPath, records);
+		double best = 0;
+		DrydockSnapshot replayed = {};
+		for (int run = 0; run < 5; run++)
+		{
+			replayed = DrydockSnapshot();
+			auto start = chrono::steady_clock::now();
+			replayed.replay(records.data(), records.size());
+			auto end = chrono::steady_clock::now();
+			double seconds = chrono::duration<double>(end - start).count();
+			if (run == 0 || seconds < best) best = seconds;
+		}
+
+		Drydock recovered;
+		auto start = chrono::steady_clock::now();
+		recovered.recover(journalPath, snapshotPath);
+		auto end = chrono::steady_clock::now();
+		DrydockSnapshot result = recovered.snapshot();
+		bool matches = result.stateIndex == expected.stateIndex && result.components == expected.components && result.energy == expected.energy
+			&& result.launchingOption == expected.launchingOption && replayed.energy == expected.energy && replayed.stateIndex == expected.stateIndex;
+		remove(journalPath);
+		remove(snapshotPath);
+
+		cout << "Replay: " << records.size() / best << " records/sec; recovery with snapshots every " << snapshotInterval << " records: "
+			<< chrono::duration<double, milli>(end - start).count() << " ms (" << (matches ? "state matches" : "STATE MISMATCH") << ")" << endl;
+	}
+
+	//Applies the stream as one Drydock::processEvents batch and returns the average ns/event
+	//Parametres:
+		//(stream) events to apply
+		//(accepted) incremented by the number of accepted events
+	static double timeBatch(const vector<DrydockEvent>& stream, unsigned& accepted)
+	{
+		Drydock dock;
+		auto start = chrono::steady_clock::now();
+		DrydockBatchResult result = dock.processEvents(stream);
+		auto end = chrono::steady_clock::now();
+		for (unsigned char code : result.results) accepted += code == Event_Accepted;
+		return chrono::duration<double, nano>(end - start).count() / stream.size();
+	}
+	//Broadcasts each event of the stream to every machine of a fleet and returns the average ns/machine-event
+	//Parametres:
+		//(stream) events to apply
+		//(machines) number of machines in the fleet
+		//(vectorised) whether the fleet may use its AVX2 step kernel
+		//(accepted) incremented by the number of accepted machine-events
+	static double timeFleet(const vector<DrydockEvent>& stream, unsigned machines, bool vectorised, unsigned& accepted)
+	{
+		DrydockFleet fleet(machines);
+		fleet.setVectorised(vectorised);
+		vector<unsigned char> results(machines);
+		auto start = chrono::steady_clock::now();
+		for (const DrydockEvent& e : stream)
+		{
+			fleet.applyToAll(e.kind, e.payload, results.data());
+			for (unsigned char code : results) accepted += code;
+		}
+		auto end = chrono::steady_clock::now();
+		return chrono::duration<double, nano>(end - start).count() / (double(stream.size()) * machines);
+	}
+	//Applies a stream of events spread across a sharded fleet and returns the events/sec of the run
+	//Parametres:
+		//(stream) event pattern each machine receives
+		//(machines) number of machines in the fleet
+		//(workers) number of worker threads
+		//(stolen) set to the number of shards stolen during the run
+	static double timeExecutor(const vector<DrydockEvent>& stream, unsigned machines, unsigned workers, unsigned long long& stolen)
+	{
+		FleetExecutor executor(machines, 64, workers);
+		for (const DrydockEvent& e : stream)
+			for (unsigned m = 0; m < machines; m++) executor.submit(m, e.kind, e.payload);
+
+		auto start = chrono::steady_clock::now();
+		executor.run();
+		auto end = chrono::steady_clock::now();
+		stolen = executor.getStolen();
+		return double(stream.size()) * machines / chrono::duration<double>(end - start).count();
+	}
+
+	//Prints FleetExecutor throughput from 1 worker up to the number of hardware threads
+	//Parametres:
+		//(stream) event pattern each machine receives
+	static void runScaling(const vector<DrydockEvent>& stream)
+	{
+		const unsigned machines = 100000;
+		unsigned cores = max(1u, thread::hardware_concurrency());
+		double single = 0;
+		for (unsigned workers = 1; ; workers = min(workers * 2, cores))
+		{
+			unsigned long long stolen = 0;
+			double rate = timeExecutor(stream, machines, workers, stolen);
+			if (workers == 1) single = rate;
+			cout << "FleetExecutor (" << machines << " machines, " << workers << " workers): " << rate << " events/sec, speedup " << rate / single << ", " << stolen << " shards stolen" << endl;
+			if (workers == cores) break;
+		}
+	}
+	//Has several producer threads submit events to one Drydock and returns the events/sec until all are applied
+	//Parametres:
+		//(producers) number of producer threads
+		//(perProducer) number of events each producer submits
+		//(locked) guard the Drydock with a mutex instead of using a DrydockIngress with a consumer thread
+	static double timeContention(unsigned producers, unsigned perProducer, bool locked)
+	{
+		const DrydockEvent supplies[3] = { { Supply_Components, 10 }, { Transfer_Energy, 20000 }, { Make_Selection, 1 + 128 } };
+		const unsigned long long total = (unsigned long long)producers * perProducer;
+		Drydock dock;
+		DrydockIngress ingress(&dock);
+		mutex dockMutex;
+		vector<thread> threads;
+
+		auto start = chrono::steady_clock::now();
+		if (!locked)
+		{
+			threads.push_back(thread([&] {
+				unsigned long long applied = 0;
+				while (applied < total) applied += ingress.drain();
+			}));
+		}
+		for (unsigned p = 0; p < producers; p++)
+		{
+			threads.push_back(thread([&, p] {
+				DrydockEvent supply = supplies[p % 3];
+				for (unsigned i = 0; i < perProducer; i++)
+				{
+					if (locked)
+					{
+						lock_guard<mutex> lock(dockMutex);
+						dock.apply(supply);
+					}
+					else while (!ingress.submit(supply.kind, supply.payload)) this_thread::yield();
+				}
+			}));
+		}
+		for (thread& t : threads) t.join();
+		auto end = chrono::steady_clock::now();
+		return total / chrono::duration<double>(end - start).count();
+	}
+
+	//Prints ingress and mutex-guarded throughput for an increasing number of producers
+	static void runContention(void)
+	{
+		const unsigned perProducer = 200000;
+		unsigned cores = max(1u, thread::hardware_concurrency());
+		for (unsigned producers = 1; producers <= max(4u, cores); producers *= 2)
+		{
+			double lockFree = timeContention(producers, perProducer, false);
+			double locked = timeContention(producers, perProducer, true);
+			cout << "Contention (" << producers << " producers): DrydockIngress " << lockFree << " events/sec, mutex-guarded Drydock " << locked << " events/sec" << endl;
+		}
+	}
+	//Has supplier threads top up energy and components while one builder thread reserves and launches ships, and returns
+	//the deposits/sec until every supplier has finished
+	//Parametres:
+		//(suppliers) number of supplier threads
+		//(perSupplier) number of energy deposits each supplier makes
+		//(locked) guard a reference Drydock with a mutex instead of using a ConcurrentDrydock
+		//(builds) set to the number of ships launched
+	static double timeAccounting(unsigned suppliers, unsigned perSupplier, bool locked, unsigned long long& builds)
+	{
+		ConcurrentDrydock concurrent;
+		Drydock dock;
+		mutex dockMutex;
+		dock.supplyComponents(1000000000);
+		atomic<unsigned> done(0);
+		vector<thread> threads;
+		builds = 0;
+
+		auto start = chrono::steady_clock::now();
+		threads.push_back(thread([&] {
+			while (done < suppliers)
+			{
+				if (locked)
+				{
+					lock_guard<mutex> lock(dockMutex);
+					if (dock.makeSelection(1) && dock.launch())
+					{
+						dock.undockShip();
+						builds++;
+					}
+				}
+				else if (concurrent.makeSelection(1) && concurrent.launch()) builds++;
+			}
+		}));
+		for (unsigned p = 0; p < suppliers; p++)
+		{
+			threads.push_back(thread([&] {
+				for (unsigned i = 0; i < perSupplier; i++)
+				{
+					if (locked)
+					{
+						lock_guard<mutex> lock(dockMutex);
+						dock.transferEnergy(1000);
+					}
+					else
+					{
+						concurrent.transferEnergy(1000);
+						if (i % 4 == 0) concurrent.supplyComponents(1);
+					}
+				}
+				done++;
+			}));
+		}
+		for (thread& t : threads) t.join();
+		auto end = chrono::steady_clock::now();
+		return (unsigned long long)suppliers * perSupplier / chrono::duration<double>(end - start).count();
+	}
+
+	//Prints concurrent and mutex-guarded resource accounting throughput for an increasing number of suppliers
+	static void runAccounting(void)
+	{
+		const unsigned perSupplier = 500000;
+		unsigned cores = max(1u, thread::hardware_concurrency());
+		for (unsigned suppliers = 1; suppliers <= max(4u, cores); suppliers *= 2)
+		{
+			unsigned long long builds[2];
+			double lockFree = timeAccounting(suppliers, perSupplier, false, builds[0]);
+			double locked = timeAccounting(suppliers, perSupplier, true, builds[1]);
+			cout << "Accounting (" << suppliers << " suppliers, 1 builder): ConcurrentDrydock " << lockFree << " deposits/sec (" << builds[0]
+				<< " launches), mutex-guarded Drydock " << locked << " deposits/sec (" << builds[1] << " launches)" << endl;
+		}
+	}
+
+	//Makes selections (half accepted and launched, half rejected for lack of components) and returns the
+	//ComponentPool counters of the run
+	//Parametres:
+		//(selections) number of selections to make
+		//(pooled) whether released Ship and Weapon blocks are kept in the pool
+	static ComponentPoolStats countAllocations(unsigned selections, bool pooled)
+	{
+		ComponentPool::setEnabled(pooled);
+		ComponentPool::resetStats();
+		{
+			Drydock dock;
+			dock.supplyComponents(1);
+			dock.transferEnergy(20000);
+			for (unsigned i = 0; i < selections; i += 2)
+			{
+				dock.makeSelection(1 + 128); //rejected: needs 2 components
+				dock.makeSelection(1);
+				dock.launch();
+				dock.undockShip();
+			}
+		}
+		ComponentPoolStats stats = ComponentPool::getStats();
+		ComponentPool::setEnabled(true);
+		return stats;
+	}
+
+	//Prints global heap allocations of Ship and Weapon objects per 1M selections without and with the pool
+	static void runAllocations(void)
+	{
+		const unsigned selections = 1000000;
+		ComponentPoolStats heap = countAllocations(selections, false);
+		ComponentPoolStats pooled = countAllocations(selections, true);
+		cout << "Component heap allocations per " << selections << " selections: " << heap.heapAllocations << " without pool, "
+			<< pooled.heapAllocations << " with pool (" << pooled.pooledAllocations << " reused)" << endl;
+	}
+
+	//Prints the memory each Drydock takes and the heap allocations made to construct one
+	static void runFootprint(void)
+	{
+		const unsigned machines = 10000;
+		Drydock** docks = new Drydock*[machines];
+		unsigned long long before = heapAllocations.load(memory_order_relaxed);
+		for (unsigned i = 0; i < machines; i++) docks[i] = new Drydock;
+		unsigned long long allocations = heapAllocations.load(memory_order_relaxed) - before;
+		for (unsigned i = 0; i < machines; i++) delete docks[i];
+		delete[] docks;
+
+		size_t states = sizeof(OutOfComponents) + sizeof(NoEnergy) + sizeof(HasEnergy) + sizeof(LaunchingShip);
+		cout << "Drydock footprint: " << sizeof(Drydock) << " bytes (StateContext " << sizeof(StateContext) << ") + " << states << " bytes of states = "
+			<< sizeof(Drydock) + states << " bytes per machine, " << double(allocations) / machines << " heap allocations per machine" << endl;
+	}
+
+	//Prints the time taken to plan a large order book and the launches the plan achieves
+	static void runPlanner(void)
+	{
+		const int options[] = { 1, 2, 4, 8, 16, 32, 64, 1 + 128, 2 + 256, 4 + 512, 8 + 1024, 16 + 2048, 32 + 4096, 64 + 8192, 3 };
+		const unsigned optionCount = sizeof(options) / sizeof(options[0]);
+		const unsigned orders = 100000;
+
+		vector<int> demand;
+		demand.reserve(orders);
+		for (unsigned i = 0; i < orders; i++) demand.push_back(options[(i * 7919u) % optionCount]);
+
+		auto start = chrono::steady_clock::now();
+		BuildPlan plan = Drydock::planBuilds(50000, 500000000, demand.data(), orders);
+		auto end = chrono::steady_clock::now();
+		cout << "Build planner (" << orders << " orders): " << chrono::duration<double, milli>(end - start).count() << " ms, "
+			<< plan.options.size() << " launches using " << plan.componentsUsed << " components and " << plan.energyUsed << " energy" << endl;
+	}
+
+	//Parses one answer the way Utility::getInteger did before InputReader, without the prompt
+	//Parametres:
+		//(input) stream to read from
+	static int legacyInteger(istream& input)
+	{
+		string text = "";
+		int processedInput = -2147483647;
+		input >> text;
+		input.ignore();
+		stringstream strStream(text);
+		strStream >> processedInput;
+		return processedInput;
+	}
+
+	//Prints the lines/sec of reading integer answers through InputReader and through the stringstream parsing it replaced
+	//Parametres:
+		//(lines) number of answers in the input file
+	static void runInputParsing(unsigned lines)
+	{
+		const char* path = "drydock_benchmark.input";
+		const char* answers[] = { "1", "10", "2", "20000", "3", "129", "4", "-1", "8193", "7" };
+		{
+			ofstream file(path, ios::binary);
+			for (unsigned i = 0; i < lines; i++) file << answers[i % 10] << '\n';
+		}
+
+		long long legacySum = 0, readerSum = 0;
+		auto start = chrono::steady_clock::now();
+		{
+			ifstream file(path, ios::binary);
+			for (unsigned i = 0; i < lines; i++) legacySum += legacyInteger(file);
+		}
+		auto middle = chrono::steady_clock::now();
+#ifdef _WIN32
+		int descriptor = _open(path, _O_RDONLY | _O_BINARY);
+#else
+		int descriptor = open(path, O_RDONLY);
+#endif
+		{
+			InputReader reader(descriptor);
+			int value = 0;
+			while (reader.readInteger(value) != Input_End) readerSum += value;
+		}
+#ifdef _WIN32
+		_close(descriptor);
+#else
+		close(descriptor);
+#endif
+		auto end = chrono::steady_clock::now();
+		remove(path);
+
+		double legacySeconds = chrono::duration<double>(middle - start).count();
+		double readerSeconds = chrono::duration<double>(end - middle).count();
+		cout << "Input parsing (" << lines << " lines): InputReader " << lines / readerSeconds << " lines/sec, stringstream "
+			<< lines / legacySeconds << " lines/sec" << (legacySum == readerSum ? "" : " (MISMATCH)") << endl;
+	}
+
+#if FSM_COROUTINES
+	//Workflow for the asynchronous Drydock benchmark: supplies, builds and launches a ship on each cycle
+	//Parametres:
+		//(dock) Drydock to build on
+		//(cycles) number of build cycles
+		//(launched) incremented for each ship launched
+	static DrydockTask shipyard(AsyncDrydock& dock, unsigned cycles, unsigned long long& launched)
+	{
+		for (unsigned i = 0; i < cycles; i++)
+		{
+			dock.supplyComponents(10);
+			dock.transferEnergy(40000);
+			if (!co_await dock.build(1 + 128)) continue;
+			if (co_await dock.launch()) launched++;
+		}
+	}
+
+	//Prints the throughput of one thread driving many AsyncDrydocks through build cycles on an event loop
+	//Parametres:
+		//(docks) number of Drydocks in flight
+		//(cycles) build cycles per Drydock
+	static void runAsync(unsigned docks, unsigned cycles)
+	{
+		EventLoop loop;
+		vector<AsyncDrydock*> yard;
+		unsigned long long launched = 0;
+		auto start = chrono::steady_clock::now();
+		for (unsigned i = 0; i < docks; i++)
+		{
+			yard.push_back(new AsyncDrydock(loop, 60 + i % 7, 10));
+			loop.spawn(shipyard(*yard.back(), cycles, launched));
+		}
+		unsigned long long ticks = loop.run();
+		auto end = chrono::steady_clock::now();
+		for (AsyncDrydock* dock : yard) delete dock;
+
+		double seconds = chrono::duration<double>(end - start).count();
+		cout << "AsyncDrydock (" << docks << " docks on one thread): " << launched << " launches over " << ticks << " ticks, "
+			<< launched / seconds << " launches/sec, " << loop.getResumes() / seconds << " resumes/sec, peak " << loop.getPeakTasks() << " tasks in flight" << endl;
+	}
+#endif
+
+	//Prints the results of a discrete-event shipyard simulation and the events simulated per wall-clock second
+	//Parametres:
+		//(events) events to simulate
+		//(docks) number of Drydocks in the shipyard
+	static void runShipyard(unsigned long long events, unsigned docks)
+	{
+		const char* stateNames[stateCount] = { "Out_Of_Components", "No_Energy", "Has_Energy", "Launching_Ship" };
+		ShipyardProfile profile;
+		profile.docks = docks;
+		ShipyardSimulator<TableDrydock> shipyard(profile);
+		const ShipyardReport& report = shipyard.run(events);
+
+		cout << "ShipyardSimulator (" << docks << " docks): " << report.events << " events over " << report.ticks / 3600.0 << " simulated hours, "
+			<< report.getEventsPerSecond() << " events/sec, " << report.wallSeconds * 1e9 / report.events << " ns/event" << endl;
+		cout << "ShipyardSimulator launches: " << report.launches << " (" << report.getLaunchesPerHour() << " per simulated hour), "
+			<< report.ordersTurnedAway << " orders turned away" << endl;
+		cout << "ShipyardSimulator time in state:";
+		for (int i = 0; i < stateCount; i++) cout << " " << stateNames[i] << " " << report.getStateShare(state(i)) * 100 << "%";
+		cout << endl;
+	}
+
+	//Prints how many setState() calls keep the current state, and the ns/event of each transition mode
+	//Parametres:
+		//(stream) events to apply
+	static void runTransitionModes(const vector<DrydockEvent>& stream)
+	{
+		for (transitionMode mode : { Every_Transition, State_Changes_Only })
+		{
+			Drydock dock;
+			dock.setTransitionMode(mode);
+			auto start = chrono::steady_clock::now();
+			for (const DrydockEvent& e : stream)
+			{
+				if (dock.apply(e) && e.kind == Launch_Ship) dock.undockShip();
+			}
+			auto end = chrono::steady_clock::now();
+			cout << "Transition mode " << (mode == Every_Transition ? "Every_Transition" : "State_Changes_Only") << ": "
+				<< chrono::duration<double, nano>(end - start).count() / stream.size() << " ns/event, " << dock.getRedundantTransitions() << " of "
+				<< dock.getTransitionCount() << " setState() calls kept the state" << (mode == Every_Transition ? "" : " and skipped the hooks") << endl;
+		}
+	}
+
+#if FSM_INSTRUMENTATION
+	//Prints the transition counters and sampled latencies gathered while the benchmarks ran
+	static void runInstrumentation(void)
+	{
+		const char* stateNames[] = { "Out_Of_Components", "No_Energy", "Has_Energy", "Launching_Ship" };
+		const char* eventNames[] = { "Transfer_Energy", "Make_Selection", "Supply_Components", "Launch_Ship" };
+		TransitionStats stats = TransitionMetrics::snapshot();
+		for (int f = 0; f < 4; f++)
+		{
+			for (int e = 0; e < 4; e++)
+			{
+				if (stats.accepted[f][e] + stats.rejected[f][e] == 0) continue;
+				cout << "Transitions " << stateNames[f] << " x " << eventNames[e] << ": " << stats.accepted[f][e] << " accepted, " << stats.rejected[f][e]
+					<< " rejected, p50 " << stats.getLatency(state(f), event(e), 0.5) << " ns, p99 " << stats.getLatency(state(f), event(e), 0.99) << " ns" << endl;
+			}
+		}
+	}
+#endif
+public:
+	//Runs every Drydock implementation over the same event stream and prints ns/event
+	//Drydocks are benchmarked without a diagnostics sink
+	static void run(unsigned count = 1000000)
+	{
+		vector<DrydockEvent> stream = makeStream(count);
+		unsigned accepted[4] = { 0, 0, 0, 0 };
+
+		double virtualTime = time<Drydock>(stream, accepted[0]);
+		double tableTime = time<TableDrydock>(stream, accepted[1]);
+		double staticTime = time<StaticDrydock>(stream, accepted[2]);
+		double batchTime = timeBatch(stream, accepted[3]);
+
+		const unsigned machines = 1000;
+		vector<DrydockEvent> fleetStream(stream.begin(), stream.begin() + count / machines);
+		unsigned fleetAccepted[2] = { 0, 0 };
+		double fleetTime = timeFleet(fleetStream, machines, false, fleetAccepted[0]);
+		double vectorTime = timeFleet(fleetStream, machines, true, fleetAccepted[1]);
+
+		cout << "Events: " << count << endl;
+		cout << "Drydock (virtual states): " << virtualTime << " ns/event, " << accepted[0] << " accepted" << endl;
+		cout << "TableDrydock (transition table): " << tableTime << " ns/event, " << accepted[1] << " accepted" << endl;
+		cout << "StaticDrydock (compile-time): " << staticTime << " ns/event, " << accepted[2] << " accepted" << endl;
+		cout << "Drydock::processEvents (batch): " << batchTime << " ns/event, " << accepted[3] << " accepted" << endl;
+		cout << "DrydockFleet (" << machines << " machines, scalar): " << fleetTime << " ns/event, " << 1e9 / fleetTime << " events/sec, " << fleetAccepted[0] << " accepted" << endl;
+		cout << "DrydockFleet (" << machines << " machines, " << (DrydockFleet::hasAvx2() ? "AVX2" : "scalar fallback") << "): " << vectorTime << " ns/event, " << 1e9 / vectorTime << " events/sec, " << fleetAccepted[1] << " accepted" << endl;
+
+		runTransitionModes(stream);
+		runInputParsing(count);
+		runScaling(vector<DrydockEvent>(stream.begin(), stream.begin() + 100));
+		runContention();
+		runAccounting();
+		runAllocations();
+		runFootprint();
+		runPlanner();
+		runJournal(stream);
+		runReplay(stream, 100000);
+		runShipyard(10000000, 10000);
+#if FSM_COROUTINES
+		runAsync(50000, 20);
+#endif
+#if FSM_INSTRUMENTATION
+		runInstrumentation();
+#endif
+	}
+
+	//Runs only the shipyard simulation
+	//Parametres:
+		//(events) events to simulate
+	static void simulate(unsigned long long events)
+	{
+		runShipyard(events, 100000);
+	}
+};
+#pragma endregion
+
+#pragma region Micro-benchmark suite
+//Results written to here cannot be optimised away
+static volatile unsigned long long benchmarkSink = 0;
+
+//Counts instructions retired by the calling thread through the Linux perf interface
+//Unavailable (count() returns -1) on other platforms or when perf events are not permitted
+class InstructionCounter
+{
+private:
+	int descriptor = -1;
+public:
+	InstructionCounter(void)
+	{
+#ifdef __linux__
+		perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.size = sizeof(attributes);
+		attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		this->descriptor = int(syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+	}
+	~InstructionCounter(void)
+	{
+#ifdef __linux__
+		if (this->descriptor >= 0) close(this->descriptor);
+#endif
+	}
+
+	//Returns whether instructions can be counted
+	bool isAvailable(void) { return this->descriptor >= 0; }
+
+	//Resets the count and starts counting
+	void start(void)
+	{
+#ifdef __linux__
+		if (this->descriptor < 0) return;
+		ioctl(this->descriptor, PERF_EVENT_IOC_RESET, 0);
+		ioctl(this->descriptor, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	}
+
+	//Stops counting and returns the instructions retired since start(), or -1 if unavailable
+	long long stop(void)
+	{
+		long long count = -1;
+#ifdef __linux__
+		if (this->descriptor < 0) return -1;
+		ioctl(this->descriptor, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(this->descriptor, &count, sizeof(count)) != sizeof(count)) count = -1;
+#endif
+		return count;
+	}
+};
+
+//Figures of one micro-benchmark, per iteration
+struct MicroResult
+{
+	string name;
+	unsigned long long iterations;
+	double realTime; //ns
+	double cpuTime; //ns
+	double baselineTime; //ns of the setup-only baseline, -1 if the benchmark has none
+	double heapAllocations;
+	double pooledAllocations; //Ship and Weapon blocks reused from the ComponentPool
+	double instructions; //-1 if instructions cannot be counted
+};
+
+//Google Benchmark-style suite of Drydock micro-benchmarks
+//Each benchmark body runs its operation a given number of times; the suite grows the count until a run lasts
+//at least the minimum time, then reports time, heap and pooled allocations and instructions per iteration
+//Transition benchmarks restore the starting state on every iteration, so each names a "Restore/<state>" baseline
+//whose time is reported alongside it
+class MicroBenchmarkSuite
+{
+private:
+	typedef function<void(unsigned long long iterations)> Body;
+	struct Entry
+	{
+		string name;
+		Body body;
+		string baseline;
+	};
+	vector<Entry> entries;
+
+	static const char* stateName(state nState)
+	{
+		const char* names[] = { "OutOfComponents", "NoEnergy", "HasEnergy", "LaunchingShip" };
+		return names[nState];
+	}
+
+	static const char* eventName(event nEvent)
+	{
+		const char* names[] = { "transferEnergy", "makeSelection", "supplyComponents", "launch" };
+		return names[nEvent];
+	}
+
+	//Returns a snapshot that puts a Drydock in the given state with enough resources for any selection
+	static DrydockSnapshot startingState(state nState)
+	{
+		DrydockSnapshot snapshot = {};
+		snapshot.stateIndex = (unsigned char)nState;
+		if (nState != Out_Of_Components) snapshot.components = 2;
+		if (nState == Has_Energy || nState == Launching_Ship) snapshot.energy = 100000;
+		if (nState == Launching_Ship) snapshot.launchingOption = 1 + 128;
+		return snapshot;
+	}
+
+	//Applies one event through the Transition methods
+	static bool applyEvent(Drydock& dock, event nEvent)
+	{
+		switch (nEvent)
+		{
+		case Transfer_Energy: return dock.transferEnergy(5000);
+		case Make_Selection: return dock.makeSelection(1 + 128);
+		case Supply_Components: return dock.supplyComponents(2);
+		case Launch_Ship: return dock.launch();
+		}
+		return false;
+	}
+
+	//Runs a body a number of times and fills in the per-iteration figures
+	static void measure(const Body& body, unsigned long long iterations, InstructionCounter& counter, MicroResult& result)
+	{
+		ComponentPool::resetStats();
+		unsigned long long heapBefore = heapAllocations.load(memory_order_relaxed);
+		clock_t cpuStart = clock();
+		auto start = chrono::steady_clock::now();
+		counter.start();
+		body(iterations);
+		long long instructions = counter.stop();
+		auto end = chrono::steady_clock::now();
+		clock_t cpuEnd = clock();
+
+		result.iterations = iterations;
+		result.realTime = chrono::duration<double, nano>(end - start).count() / iterations;
+		result.cpuTime = double(cpuEnd - cpuStart) * 1e9 / CLOCKS_PER_SEC / iterations;
+		result.heapAllocations = double(heapAllocations.load(memory_order_relaxed) - heapBefore) / iterations;
+		result.pooledAllocations = double(ComponentPool::getStats().pooledAllocations) / iterations;
+		result.instructions = instructions < 0 ? -1 : double(instructions) / iterations;
+	}
+
+	static string escape(const string& text)
+	{
+		string escaped;
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\') escaped += '\\';
+			escaped += c;
+		}
+		return escaped;
+	}
+public:
+	//Registers every Drydock micro-benchmark
+	MicroBenchmarkSuite(void)
+	{
+		//setup-only baselines and every (state, event) pair of the class-per-state Drydock
+		for (int s = Out_Of_Components; s <= Launching_Ship; s++)
+		{
+			DrydockSnapshot snapshot = startingState(state(s));
+			string restoreName = string("Restore/") + stateName(state(s));
+			this->add(restoreName, [snapshot](unsigned long long iterations) {
+				Drydock dock;
+				for (unsigned long long i = 0; i < iterations; i++)
+				{
+					dock.restore(snapshot);
+					benchmarkSink = dock.getStateIndex();
+				}
+			});
+			for (int e = Transfer_Energy; e <= Launch_Ship; e++)
+			{
+				event nEvent = event(e);
+				this->add(string("Transition/") + stateName(state(s)) + "/" + eventName(nEvent), [snapshot, nEvent](unsigned long long iterations) {
+					Drydock dock;
+					for (unsigned long long i = 0; i < iterations; i++)
+					{
+						dock.restore(snapshot);
+						benchmarkSink = applyEvent(dock, nEvent);
+					}
+				}, restoreName);
+			}
+		}
+
+		//makeSelection for every catalog configuration
+		DrydockSnapshot hasEnergy = startingState(Has_Energy);
+		hasEnergy.energy = 2000000000;
+		for (int ship = 0; ship < shipCount; ship++)
+		{
+			for (int weapon = -1; weapon < weaponCount; weapon++)
+			{
+				int option = shipCatalog[ship].code + (weapon < 0 ? 0 : weaponCatalog[weapon].code);
+				this->add("MakeSelection/" + to_string(option), [hasEnergy, option](unsigned long long iterations) {
+					Drydock dock;
+					for (unsigned long long i = 0; i < iterations; i++)
+					{
+						dock.restore(hasEnergy);
+						benchmarkSink = dock.makeSelection(option);
+					}
+				}, "Restore/HasEnergy");
+			}
+		}
+
+		//Ship::getName and Ship::getCost of every ship class, armed with the weapon of the same catalog position
+		for (int ship = 0; ship < shipCount; ship++)
+		{
+			int option = shipCatalog[ship].code + weaponCatalog[min(ship, weaponCount - 1)].code;
+			auto buildShip = [option](void) {
+				Drydock dock;
+				dock.supplyComponents(2);
+				dock.transferEnergy(2000000000);
+				dock.makeSelection(option);
+				dock.launch();
+				return dock.undockShip();
+			};
+			this->add(string("Ship/getName/") + shipCatalog[ship].name, [buildShip](unsigned long long iterations) {
+				ShipHandle ship = buildShip();
+				for (unsigned long long i = 0; i < iterations; i++) benchmarkSink = ship->getName().size();
+			});
+			this->add(string("Ship/getCost/") + shipCatalog[ship].name, [buildShip](unsigned long long iterations) {
+				ShipHandle ship = buildShip();
+				for (unsigned long long i = 0; i < iterations; i++) benchmarkSink = ship->getCost();
+			});
+		}
+
+		this->add("Drydock/ConstructDestroy", [](unsigned long long iterations) {
+			for (unsigned long long i = 0; i < iterations; i++)
+			{
+				Drydock* dock = new Drydock;
+				benchmarkSink = dock->getStateIndex();
+				delete dock;
+			}
+		});
+
+		//supply, transfer, select, launch and undock: one full build cycle per iteration
+		this->add("Cycle/BuildAndLaunch", [](unsigned long long iterations) {
+			Drydock dock;
+			for (unsigned long long i = 0; i < iterations; i++)
+			{
+				dock.supplyComponents(2);
+				dock.transferEnergy(20000);
+				dock.makeSelection(1 + 128);
+				dock.launch();
+				benchmarkSink = dock.undockShip() != nullptr;
+			}
+		});
+		this->add("Cycle/BuildAndLaunch/TableDrydock", [](unsigned long long iterations) {
+			TableDrydock dock;
+			for (unsigned long long i = 0; i < iterations; i++)
+			{
+				dock.supplyComponents(2);
+				dock.transferEnergy(20000);
+				dock.makeSelection(1 + 128);
+				dock.launch();
+				benchmarkSink = dock.undockShip() != nullptr;
+			}
+		});
+	}
+
+	//Registers a benchmark
+	//Parametres:
+		//(name) benchmark name, '/'-separated like Google Benchmark
+		//(body) runs the operation the given number of times
+		//(baseline) name of a benchmark measuring the setup included in (body), or empty
+	void add(const string& name, Body body, const string& baseline = "")
+	{
+		this->entries.push_back({ name, body, baseline });
+	}
+
+	//Runs the benchmarks whose names contain (filter)
+	//Parametres:
+		//(filter) substring of the benchmark names to run (empty runs every benchmark)
+		//(minTime) minimum duration of the measured run in seconds
+	vector<MicroResult> run(const string& filter, double minTime)
+	{
+		InstructionCounter counter;
+		vector<MicroResult> results;
+		for (const Entry& entry : this->entries)
+		{
+			if (!filter.empty() && entry.name.find(filter) == string::npos) continue;
+
+			MicroResult result = { entry.name, 0, 0, 0, -1, 0, 0, -1 };
+			unsigned long long iterations = 1;
+			while (true)
+			{
+				measure(entry.body, iterations, counter, result);
+				double seconds = result.realTime * iterations * 1e-9;
+				if (seconds >= minTime || iterations >= (1ull << 40)) break;
+				//aim 20% past the minimum time, growing at most tenfold per step
+				double scale = seconds > 0 ? minTime * 1.2 / seconds : 10;
+				iterations = (unsigned long long)(iterations * min(10.0, max(scale, 2.0)));
+			}
+			for (const MicroResult& earlier : results)
+				if (earlier.name == entry.baseline) result.baselineTime = earlier.realTime;
+			results.push_back(result);
+		}
+		return results;
+	}
+
+	//Prints results as a console table
+	static void printTable(const vector<MicroResult>& results, ostream& output = cout)
+	{
+		for (const MicroResult& r : results)
+		{
+			output << r.name << ": " << r.realTime << " ns";
+			if (r.baselineTime >= 0) output << " (" << r.realTime - r.baselineTime << " ns past baseline)";
+			output << ", " << r.heapAllocations << " heap / " << r.pooledAllocations << " pooled allocations";
+			if (r.instructions >= 0) output << ", " << r.instructions << " instructions";
+			output << ", " << r.iterations << " iterations" << endl;
+		}
+	}
+
+	//Prints results as Google Benchmark-compatible JSON
+	//Parametres:
+		//(results) results of run()
+		//(executable) path of the benchmark binary, recorded in the context
+		//(output) stream to write to
+	static void printJson(const vector<MicroResult>& results, const string& executable, ostream& output = cout)
+	{
+		char date[32] = "";
+		time_t now = time(nullptr);
+		strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+		output << "{\n  \"context\": {\n";
+		output << "    \"date\": \"" << date << "\",\n";
+		output << "    \"executable\": \"" << escape(executable) << "\",\n";
+		output << "    \"num_cpus\": " << thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+		output << "    \"library_build_type\": \"release\",\n";
+#else
+		output << "    \"library_build_type\": \"debug\",\n";
+#endif
+		output << "    \"fsm_diagnostics\": " << FSM_DIAGNOSTICS << ",\n";
+		output << "    \"fsm_instrumentation\": " << FSM_INSTRUMENTATION << ",\n";
+		output << "    \"avx2\": " << (DrydockFleet::hasAvx2() ? "true" : "false") << "\n";
+		output << "  },\n  \"benchmarks\": [";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const MicroResult& r = results[i];
+			output << (i ? "," : "") << "\n    {\n";
+			output << "      \"name\": \"" << escape(r.name) << "\",\n";
+			output << "      \"run_name\": \"" << escape(r.name) << "\",\n";
+			output << "      \"run_type\": \"iteration\",\n";
+			output << "      \"iterations\": " << r.iterations << ",\n";
+			output << "      \"real_time\": " << r.realTime << ",\n";
+			output << "      \"cpu_time\": " << r.cpuTime << ",\n";
+			output << "      \"time_unit\": \"ns\",\n";
+			if (r.baselineTime >= 0) output << "      \"baseline_time\": " << r.baselineTime << ",\n";
+			if (r.instructions >= 0) output << "      \"instructions_per_iteration\": " << r.instructions << ",\n";
+			output << "      \"allocations_per_iteration\": " << r.heapAllocations << ",\n";
+			output << "      \"pooled_allocations_per_iteration\": " << r.pooledAllocations << "\n";
+			output << "    }";
+		}
+		output << "\n  ]\n}" << endl;
+	}
+};
+#pragma endregion
+
+//Command line:
+	//(no arguments) engine comparison followed by the micro-benchmark suite as a table
+	//(--json[=path]) only the suite, as JSON on stdout or in the given file
+	//(--filter=text) only suite benchmarks whose names contain the text
+	//(--min-time=seconds) minimum measured time per suite benchmark (defaulted as 0.05)
+	//(--simulate[=events]) only the shipyard simulation, of 100000 Drydocks (defaulted as 10^8 events)
+int main(int argc, char* argv[])
+{
+	bool json = false;
+	string jsonPath, filter;
+	double minTime = 0.05;
+	unsigned long long simulateEvents = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		string argument = argv[i];
+		if (argument == "--json") json = true;
+		else if (argument.compare(0, 7, "--json=") == 0)
+		{
+			json = true;
+			jsonPath = argument.substr(7);
+		}
+		else if (argument.compare(0, 9, "--filter=") == 0) filter = argument.substr(9);
+		else if (argument.compare(0, 11, "--min-time=") == 0) minTime = atof(argument.c_str() + 11);
+		else if (argument == "--simulate") simulateEvents = 100000000;
+		else if (argument.compare(0, 11, "--simulate=") == 0) simulateEvents = strtoull(argument.c_str() + 11, nullptr, 10);
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [--json[=path]] [--filter=text] [--min-time=seconds] [--simulate[=events]]" << endl;
+			return 1;
+		}
+	}
+
+	if (simulateEvents)
+	{
+		DrydockBenchmark::simulate(simulateEvents);
+		return 0;
+	}
+
+	if (!json) DrydockBenchmark::run();
+	MicroBenchmarkSuite suite;
+	vector<MicroResult> results = suite.run(filter, minTime);
+	if (!json) MicroBenchmarkSuite::printTable(results);
+	else if (jsonPath.empty()) MicroBenchmarkSuite::printJson(results, argv[0]);
+	else
+	{
+		ofstream output(jsonPath);
+		MicroBenchmarkSuite::printJson(results, argv[0], output);
+	}
+	return 0;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+/*
+	Drydock diagnostics sinks
+
+	Notes:
+		Sinks a StateContext can report diagnostics into (see StateContext::setDiagnostics())
+*/
+
+#include "FSM.h"
+
+#pragma region Diagnostics sinks
+//Writes a diagnostic as the line of text the Drydock states used to print (defined in FSM.cpp)
+void formatDiagnostic(std::ostream& out, const Diagnostic& record);
+
+//Sink that discards every diagnostic
+//Equivalent to leaving the StateContext without a sink; define FSM_DIAGNOSTICS as 0 to also remove the reporting calls
+class NullSink : public DiagnosticsSink
+{
+public:
+	void write(const Diagnostic& record) {}
+};
+
+//Sink that buffers diagnostics in memory and formats them as text only when flushed
+//Intended for the interactive UI, which flushes once an event has been handled
+class BufferedTextSink : public DiagnosticsSink
+{
+private:
+	std::vector<Diagnostic> records;
+public:
+	BufferedTextSink(void) { this->records.reserve(64); }
+
+	void write(const Diagnostic& record) { this->records.push_back(record); }
+
+	//Formats and writes out all buffered diagnostics, then empties the buffer
+	//Parametres:
+		//(out) stream to write to (defaulted as console output)
+	void flush(std::ostream& out = std::cout)
+	{
+		for (const Diagnostic& record : this->records) formatDiagnostic(out, record);
+		out.flush();
+		this->records.clear();
+	}
+};
+
+//Sink that copies diagnostics into a fixed-size lock-free ring buffer, drained by a background thread
+//Single producer (the thread driving the StateContext), single consumer (the drain thread)
+//If the ring is full the diagnostic is dropped and counted rather than blocking the producer
+class RingBufferSink : public DiagnosticsSink
+{
+private:
+	std::vector<Diagnostic> ring;
+	size_t mask = 0;
+	std::atomic<size_t> head{ 0 }; //next slot to be written by the producer
+	std::atomic<size_t> tail{ 0 }; //next slot to be read by the drain thread
+	std::atomic<size_t> dropped{ 0 };
+	std::atomic<bool> running{ true };
+	std::ostream* out = nullptr;
+	bool asText = false;
+	std::thread drainer;
+
+	//Drain thread body; writes records out until the sink is destroyed and the ring is empty
+	void drain(void)
+	{
+		while (true)
+		{
+			size_t readPos = this->tail.load(std::memory_order_relaxed);
+			size_t writePos = this->head.load(std::memory_order_acquire);
+			if (readPos == writePos)
+			{
+				if (this->running.load(std::memory_order_acquire))
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					continue;
+				}
+
+				//records published before the sink was stopped may have arrived since head was loaded
+				writePos = this->head.load(std::memory_order_acquire);
+				if (readPos == writePos) break;
+			}
+
+			while (readPos != writePos)
+			{
+				Diagnostic record = this->ring[readPos & this->mask];
+				this->tail.store(++readPos, std::memory_order_release);
+				if (this->asText) formatDiagnostic(*this->out, record);
+				else this->out->write(reinterpret_cast<const char*>(&record), sizeof(record));
+			}
+			this->out->flush();
+		}
+	}
+public:
+	//Parametres:
+		//(nOut) stream the drain thread writes to
+		//(capacity) minimum number of records the ring can hold (rounded up to a power of two)
+		//(nAsText) write formatted text instead of raw binary Diagnostic records
+	RingBufferSink(std::ostream& nOut, unsigned capacity = 4096, bool nAsText = false)
+	{
+		size_t size = 1;
+		while (size < capacity) size <<= 1;
+		this->ring.resize(size);
+		this->mask = size - 1;
+		this->out = &nOut;
+		this->asText = nAsText;
+		this->drainer = std::thread(&RingBufferSink::drain, this);
+	}
+
+	//Stops the drain thread once every buffered diagnostic has been written out
+	~RingBufferSink(void)
+	{
+		this->running.store(false, std::memory_order_release);
+		this->drainer.join();
+	}
+
+	void write(const Diagnostic& record)
+	{
+		size_t writePos = this->head.load(std::memory_order_relaxed);
+		if (writePos - this->tail.load(std::memory_order_acquire) == this->ring.size())
+		{
+			this->dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		this->ring[writePos & this->mask] = record;
+		this->head.store(writePos + 1, std::memory_order_release);
+	}
+
+	//Returns the number of diagnostics dropped because the ring was full
+	size_t getDropped(void) { return this->dropped.load(std::memory_order_relaxed); }
+};
+#pragma endregion
@@ -0,0 +1,910 @@
+#pragma once
+
+/*
+	Alternative Drydock engines
+
+	Notes:
+		Compile-time Drydock, structure-of-arrays fleet, sharded fleet executor and multi-producer event ingress
+		Each produces the same results as the reference Drydock in FSM.h, except the concurrent Drydock, which keeps
+		running resource totals so that suppliers and builders can work on it at once
+*/
+
+#include "FSM.h"
+
+#pragma region Compile-time Drydock
+//Drydock specialised at compile time for the fixed state and event sets
+//States are empty tag types held in a std::variant and events are dispatched by overload resolution,
+//so the compiler can inline the whole dispatch: no heap-allocated State objects and no virtual calls
+//The assembled ship is kept as its option cost and component count rather than as a Ship object
+class StaticDrydock
+{
+private:
+	struct OutOfComponentsTag {};
+	struct NoEnergyTag {};
+	struct HasEnergyTag {};
+	struct LaunchingShipTag {};
+	template<event E> struct EventTag {};
+
+	//Order of alternatives matches the state enumeration
+	std::variant<OutOfComponentsTag, NoEnergyTag, HasEnergyTag, LaunchingShipTag> currentState;
+	unsigned parametres[2] = { 0, 0 };
+	unsigned launchingCost = 0;
+	unsigned launchingComponents = 0;
+
+	//Events that are invalid in a state are rejected and leave the state unchanged
+	template<class S, event E> bool on(S&, EventTag<E>, int) { return false; }
+
+	bool on(OutOfComponentsTag&, EventTag<Supply_Components>, int components)
+	{
+		this->parametres[Components] = components;
+		this->currentState = NoEnergyTag();
+		return true;
+	}
+
+	bool on(NoEnergyTag&, EventTag<Transfer_Energy>, int energy)
+	{
+		if (energy <= 0) return false;
+		this->parametres[Energy] += energy;
+		this->currentState = HasEnergyTag();
+		return true;
+	}
+
+	bool on(HasEnergyTag&, EventTag<Transfer_Energy>, int energy)
+	{
+		if (energy <= 0) return false;
+		this->parametres[Energy] += energy;
+		return true;
+	}
+
+	bool on(HasEnergyTag&, EventTag<Make_Selection>, int option)
+	{
+		OptionCost selection = decodeOption(option);
+		if (!selection.valid || selection.cost > this->parametres[Energy] || selection.componentsNeeded > this->parametres[Components]) return false;
+		this->launchingCost = selection.cost;
+		this->launchingComponents = selection.componentsNeeded;
+		this->currentState = LaunchingShipTag();
+		return true;
+	}
+
+	bool on(HasEnergyTag&, EventTag<Supply_Components>, int components)
+	{
+		this->parametres[Components] = components;
+		return true;
+	}
+
+	bool on(HasEnergyTag&, EventTag<Launch_Ship>, int)
+	{
+		this->currentState = NoEnergyTag();
+		return false;
+	}
+
+	bool on(LaunchingShipTag&, EventTag<Launch_Ship>, int)
+	{
+		this->parametres[Components] -= this->launchingComponents;
+		this->parametres[Energy] -= this->launchingCost;
+
+		if (this->parametres[Components] == 0)
+		{
+			this->parametres[Energy] = 0;
+			this->currentState = OutOfComponentsTag();
+		}
+		else if (this->parametres[Energy] == 0) this->currentState = NoEnergyTag();
+		else this->currentState = HasEnergyTag();
+		return true;
+	}
+
+	//Dispatches an event to the handler for the current state
+	//Parametres:
+		//(payload) integer argument of the event
+	template<event E> bool handle(int payload)
+	{
+		return visit([this, payload](auto& current) { return this->on(current, EventTag<E>(), payload); }, this->currentState);
+	}
+public:
+	bool transferEnergy(int energy) { return this->handle<Transfer_Energy>(energy); }
+	bool makeSelection(int option) { return this->handle<Make_Selection>(option); }
+	bool supplyComponents(int components) { return this->handle<Supply_Components>(components); }
+	bool launch(void) { return this->handle<Launch_Ship>(0); }
+
+	//Returns the current operating state
+	state getState(void) const { return state(this->currentState.index()); }
+
+	//Returns desired parametre value
+	//Parametres:
+		//(param) enumeration of the parametre to get
+	unsigned getParamVal(parametre param) const { return this->parametres[param]; }
+};
+#pragma endregion
+
+#pragma region Drydock fleet
+//Pointers to the parallel arrays of a DrydockFleet, as handed to the step kernels
+struct FleetLanes
+{
+	unsigned* states;
+	unsigned* components;
+	unsigned* energy;
+	unsigned* pendingOptions;
+	unsigned* pendingComponents; //components needed by the pending ship, subtracted from Components on launch
+	unsigned* pendingCosts; //cost of the pending ship, subtracted from Energy on launch
+};
+
+//Many independent Drydocks stored as a structure of arrays
+//Each machine is its state index, Components, Energy and the option code of the ship it is launching,
+//held in contiguous parallel arrays instead of a heap-allocated Drydock with State, parametre and Ship objects
+//Every machine gives the same results as a single Drydock driven with the same events
+//Bulk passes run through a step kernel chosen at runtime: AVX2 when the CPU supports it, otherwise a branchless
+//scalar kernel that the compiler can auto-vectorise with SSE2
+class DrydockFleet
+{
+private:
+	//Applies one event kind to machines [begin, end) of the fleet
+	//Parametres:
+		//(lanes) arrays of the fleet
+		//(kind) enumeration of the event
+		//(payloads) one payload per machine, or nullptr to use (payload) for every machine
+		//(payload) shared payload when (payloads) is nullptr
+		//(results) optional output of one eventResult code per machine
+		//(begin) first machine of the range
+		//(end) one past the last machine of the range
+	typedef void(*StepKernel)(const FleetLanes& lanes, event kind, const int* payloads, int payload, unsigned char* results, unsigned begin, unsigned end);
+
+	std::vector<unsigned> states;
+	std::vector<unsigned> components;
+	std::vector<unsigned> energy;
+	std::vector<unsigned> pendingOptions;
+	std::vector<unsigned> pendingComponents;
+	std::vector<unsigned> pendingCosts;
+	StepKernel kernel = nullptr;
+
+	FleetLanes lanes(void)
+	{
+		return { this->states.data(), this->components.data(), this->energy.data(), this->pendingOptions.data(), this->pendingComponents.data(), this->pendingCosts.data() };
+	}
+
+	//Applies an event to one machine, returning whether it was accepted
+	//Parametres:
+		//(machine) index of the machine
+		//(kind) enumeration of the event
+		//(payload) integer argument of the event
+	bool step(unsigned machine, event kind, int payload)
+	{
+		unsigned& current = this->states[machine];
+		switch (kind)
+		{
+		case Transfer_Energy:
+			if ((current != No_Energy && current != Has_Energy) || payload <= 0) return false;
+			this->energy[machine] += payload;
+			current = Has_Energy;
+			return true;
+		case Make_Selection:
+		{
+			if (current != Has_Energy) return false;
+			OptionCost selection = decodeOption(payload);
+			if (!selection.valid || selection.cost > this->energy[machine] || selection.componentsNeeded > this->components[machine]) return false;
+			this->pendingOptions[machine] = payload;
+			this->pendingComponents[machine] = selection.componentsNeeded;
+			this->pendingCosts[machine] = selection.cost;
+			current = Launching_Ship;
+			return true;
+		}
+		case Supply_Components:
+			if (current != Out_Of_Components && current != Has_Energy) return false;
+			this->components[machine] = payload;
+			if (current == Out_Of_Components) current = No_Energy;
+			return true;
+		case Launch_Ship:
+			if (current == Has_Energy) current = No_Energy;
+			if (current != Launching_Ship) return false;
+			this->components[machine] -= this->pendingComponents[machine];
+			this->energy[machine] -= this->pendingCosts[machine];
+			if (this->components[machine] == 0)
+			{
+				this->energy[machine] = 0;
+				current = Out_Of_Components;
+			}
+			else if (this->energy[machine] == 0) current = No_Energy;
+			else current = Has_Energy;
+			return true;
+		}
+		return false;
+	}
+
+	//Branchless scalar step kernel
+	static void stepScalar(const FleetLanes& lanes, event kind, const int* payloads, int payload, unsigned char* results, unsigned begin, unsigned end)
+	{
+		unsigned* states = lanes.states;
+		unsigned* components = lanes.components;
+		unsigned* energy = lanes.energy;
+		switch (kind)
+		{
+		case Transfer_Energy:
+			for (unsigned i = begin; i < end; i++)
+			{
+				int amount = payloads ? payloads[i] : payload;
+				bool accepted = (states[i] == No_Energy || states[i] == Has_Energy) && amount > 0;
+				energy[i] += accepted ? unsigned(amount) : 0;
+				states[i] = accepted ? unsigned(Has_Energy) : states[i];
+				if (results) results[i] = accepted;
+			}
+			break;
+		case Make_Selection:
+		{
+			OptionCost shared = decodeOption(payload);
+			for (unsigned i = begin; i < end; i++)
+			{
+				OptionCost selection = payloads ? decodeOption(payloads[i]) : shared;
+				bool accepted = states[i] == Has_Energy && selection.valid && selection.cost <= energy[i] && selection.componentsNeeded <= components[i];
+				lanes.pendingOptions[i] = accepted ? unsigned(payloads ? payloads[i] : payload) : lanes.pendingOptions[i];
+				lanes.pendingComponents[i] = accepted ? selection.componentsNeeded : lanes.pendingComponents[i];
+				lanes.pendingCosts[i] = accepted ? selection.cost : lanes.pendingCosts[i];
+				states[i] = accepted ? unsigned(Launching_Ship) : states[i];
+				if (results) results[i] = accepted;
+			}
+			break;
+		}
+		case Supply_Components:
+			for (unsigned i = begin; i < end; i++)
+			{
+				int amount = payloads ? payloads[i] : payload;
+				bool accepted = states[i] == Out_Of_Components || states[i] == Has_Energy;
+				components[i] = accepted ? unsigned(amount) : components[i];
+				states[i] = states[i] == Out_Of_Components ? unsigned(No_Energy) : states[i];
+				if (results) results[i] = accepted;
+			}
+			break;
+		case Launch_Ship:
+			for (unsigned i = begin; i < end; i++)
+			{
+				bool accepted = states[i] == Launching_Ship;
+				unsigned componentsLeft = components[i] - lanes.pendingComponents[i];
+				unsigned energyLeft = componentsLeft == 0 ? 0 : energy[i] - lanes.pendingCosts[i];
+				unsigned launched = componentsLeft == 0 ? unsigned(Out_Of_Components) : energyLeft == 0 ? unsigned(No_Energy) : unsigned(Has_Energy);
+				components[i] = accepted ? componentsLeft : components[i];
+				energy[i] = accepted ? energyLeft : energy[i];
+				states[i] = accepted ? launched : states[i] == Has_Energy ? unsigned(No_Energy) : states[i];
+				if (results) results[i] = accepted;
+			}
+			break;
+		}
+	}
+
+#if FSM_X86
+	//Writes the eventResult codes of 8 lanes from an all-ones/all-zeros lane mask
+	FSM_TARGET_AVX2 static void storeResults(unsigned char* results, __m256i accepted)
+	{
+		int bits = _mm256_movemask_ps(_mm256_castsi256_ps(accepted));
+		for (int lane = 0; lane < 8; lane++) results[lane] = (bits >> lane) & 1;
+	}
+
+	//Returns an all-ones lane where (a) <= (b) as unsigned integers
+	FSM_TARGET_AVX2 static __m256i lessEqual(__m256i a, __m256i b) { return _mm256_cmpeq_epi32(_mm256_max_epu32(a, b), b); }
+
+	//AVX2 step kernel; handles 8 machines per iteration and leaves the remainder to the scalar kernel
+	//Selections with per-machine payloads need a per-lane decode, so they are left to the scalar kernel
+	FSM_TARGET_AVX2 static void stepAvx2(const FleetLanes& lanes, event kind, const int* payloads, int payload, unsigned char* results, unsigned begin, unsigned end)
+	{
+		OptionCost shared = decodeOption(payload);
+		if (kind == Make_Selection && (payloads || !shared.valid))
+		{
+			stepScalar(lanes, kind, payloads, payload, results, begin, end);
+			return;
+		}
+
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i outOfComponents = _mm256_set1_epi32(Out_Of_Components);
+		const __m256i noEnergy = _mm256_set1_epi32(No_Energy);
+		const __m256i hasEnergy = _mm256_set1_epi32(Has_Energy);
+		const __m256i launchingShip = _mm256_set1_epi32(Launching_Ship);
+		const __m256i sharedPayload = _mm256_set1_epi32(payload);
+
+		unsigned i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256i* stateLane = (__m256i*)(lanes.states + i);
+			__m256i* componentLane = (__m256i*)(lanes.components + i);
+			__m256i* energyLane = (__m256i*)(lanes.energy + i);
+			__m256i current = _mm256_loadu_si256(stateLane);
+			__m256i amount = payloads ? _mm256_loadu_si256((const __m256i*)(payloads + i)) : sharedPayload;
+			__m256i accepted;
+
+			switch (kind)
+			{
+			case Transfer_Energy:
+			{
+				__m256i powered = _mm256_or_si256(_mm256_cmpeq_epi32(current, noEnergy), _mm256_cmpeq_epi32(current, hasEnergy));
+				accepted = _mm256_and_si256(powered, _mm256_cmpgt_epi32(amount, zero));
+				__m256i energy = _mm256_loadu_si256(energyLane);
+				_mm256_storeu_si256(energyLane, _mm256_add_epi32(energy, _mm256_and_si256(accepted, amount)));
+				current = _mm256_blendv_epi8(current, hasEnergy, accepted);
+				break;
+			}
+			case Make_Selection:
+			{
+				__m256i energy = _mm256_loadu_si256(energyLane);
+				__m256i components = _mm256_loadu_si256(componentLane);
+				accepted = _mm256_cmpeq_epi32(current, hasEnergy);
+				accepted = _mm256_and_si256(accepted, lessEqual(_mm256_set1_epi32(shared.cost), energy));
+				accepted = _mm256_and_si256(accepted, lessEqual(_mm256_set1_epi32(shared.componentsNeeded), components));
+				__m256i* optionLane = (__m256i*)(lanes.pendingOptions + i);
+				__m256i* neededLane = (__m256i*)(lanes.pendingComponents + i);
+				__m256i* costLane = (__m256i*)(lanes.pendingCosts + i);
+				_mm256_storeu_si256(optionLane, _mm256_blendv_epi8(_mm256_loadu_si256(optionLane), sharedPayload, accepted));
+				_mm256_storeu_si256(neededLane, _mm256_blendv_epi8(_mm256_loadu_si256(neededLane), _mm256_set1_epi32(shared.componentsNeeded), accepted));
+				_mm256_storeu_si256(costLane, _mm256_blendv_epi8(_mm256_loadu_si256(costLane), _mm256_set1_epi32(shared.cost), accepted));
+				current = _mm256_blendv_epi8(current, launchingShip, accepted);
+				break;
+			}
+			case Supply_Components:
+			{
+				__m256i empty = _mm256_cmpeq_epi32(current, outOfComponents);
+				accepted = _mm256_or_si256(empty, _mm256_cmpeq_epi32(current, hasEnergy));
+				_mm256_storeu_si256(componentLane, _mm256_blendv_epi8(_mm256_loadu_si256(componentLane), amount, accepted));
+				current = _mm256_blendv_epi8(current, noEnergy, empty);
+				break;
+			}
+			default: //Launch_Ship
+			{
+				__m256i components = _mm256_sub_epi32(_mm256_loadu_si256(componentLane), _mm256_loadu_si256((const __m256i*)(lanes.pendingComponents + i)));
+				__m256i exhausted = _mm256_cmpeq_epi32(components, zero);
+				__m256i energy = _mm256_andnot_si256(exhausted, _mm256_sub_epi32(_mm256_loadu_si256(energyLane), _mm256_loadu_si256((const __m256i*)(lanes.pendingCosts + i))));
+				__m256i launched = _mm256_blendv_epi8(hasEnergy, noEnergy, _mm256_cmpeq_epi32(energy, zero));
+				launched = _mm256_blendv_epi8(launched, outOfComponents, exhausted);
+
+				accepted = _mm256_cmpeq_epi32(current, launchingShip);
+				__m256i unassembled = _mm256_cmpeq_epi32(current, hasEnergy);
+				_mm256_storeu_si256(componentLane, _mm256_blendv_epi8(_mm256_loadu_si256(componentLane), components, accepted));
+				_mm256_storeu_si256(energyLane, _mm256_blendv_epi8(_mm256_loadu_si256(energyLane), energy, accepted));
+				current = _mm256_blendv_epi8(current, launched, accepted);
+				current = _mm256_blendv_epi8(current, noEnergy, unassembled);
+				break;
+			}
+			}
+
+			_mm256_storeu_si256(stateLane, current);
+			if (results) storeResults(results + i, accepted);
+		}
+		stepScalar(lanes, kind, payloads, payload, results, i, end);
+	}
+#endif
+public:
+	//Parametres:
+		//(count) number of machines in the fleet, all starting out of components
+	DrydockFleet(unsigned count) : states(count, Out_Of_Components), components(count, 0), energy(count, 0), pendingOptions(count, 0), pendingComponents(count, 0), pendingCosts(count, 0)
+	{
+		this->setVectorised(true);
+	}
+
+	//Returns whether the CPU (and operating system) support AVX2
+	static bool hasAvx2(void)
+	{
+#if FSM_X86 && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		return osAvx && (info[1] & (1 << 5));
+#elif FSM_X86
+		return __builtin_cpu_supports("avx2");
+#else
+		return false;
+#endif
+	}
+
+	//Selects the step kernel used by bulk passes
+	//Parametres:
+		//(enabled) use the AVX2 kernel if the CPU supports it, otherwise always use the scalar kernel
+	void setVectorised(bool enabled)
+	{
+		this->kernel = stepScalar;
+#if FSM_X86
+		if (enabled && hasAvx2()) this->kernel = stepAvx2;
+#endif
+	}
+
+	//Returns whether bulk passes run through the AVX2 kernel
+	bool isVectorised(void) { return this->kernel != stepScalar; }
+
+	//Returns the number of machines in the fleet
+	unsigned size(void) { return unsigned(this->states.size()); }
+
+	//Applies an event to one machine, returning whether it was accepted
+	//Parametres:
+		//(machine) index of the machine
+		//(kind) enumeration of the event
+		//(payload) integer argument of the event
+	bool apply(unsigned machine, event kind, int payload) { return this->step(machine, kind, payload); }
+
+	//Applies one event of the same kind to every machine in a single pass
+	//Parametres:
+		//(kind) enumeration of the event
+		//(payloads) one payload per machine
+		//(results) optional output of one eventResult code per machine
+	void applyToAll(event kind, const int* payloads, unsigned char* results = nullptr)
+	{
+		this->kernel(this->lanes(), kind, payloads, 0, results, 0, this->size());
+	}
+
+	//Applies the same event and payload to every machine in a single pass
+	//Parametres:
+		//(kind) enumeration of the event
+		//(payload) integer argument of the event
+		//(results) optional output of one eventResult code per machine
+	void applyToAll(event kind, int payload, unsigned char* results = nullptr)
+	{
+		this->kernel(this->lanes(), kind, nullptr, payload, results, 0, this->size());
+	}
+
+	//Applies a batch of events addressed to individual machines, in order
+	//Parametres:
+		//(machines) index of the machine each event is addressed to
+		//(events) events to apply
+		//(count) number of events
+		//(results) optional output of one eventResult code per event
+	void applyEvents(const unsigned* machines, const DrydockEvent* events, unsigned count, unsigned char* results = nullptr)
+	{
+		for (unsigned i = 0; i < count; i++)
+		{
+			bool accepted = this->step(machines[i], events[i].kind, events[i].payload);
+			if (results) results[i] = accepted ? Event_Accepted : Event_Rejected;
+		}
+	}
+
+	//Returns the current operating state of a machine
+	//Parametres:
+		//(machine) index of the machine
+	state getState(unsigned machine) { return state(this->states[machine]); }
+
+	//Returns desired parametre value of a machine
+	//Parametres:
+		//(machine) index of the machine
+		//(param) enumeration of the parametre to get
+	unsigned getParamVal(unsigned machine, parametre param) { return param == Components ? this->components[machine] : this->energy[machine]; }
+};
+#pragma endregion
+
+#pragma region Sharded fleet executor
+//Drives a fleet of Drydocks split into shards across worker threads
+//Each shard owns a contiguous block of machines (as a DrydockFleet) and queues the events addressed to them
+//A shard is only ever processed by the one worker that claimed it for the round, so no locks are taken while
+//events are applied and events for one Drydock are applied strictly in submission order
+//Workers first claim their home shards, then steal any unclaimed shard that still has queued events
+class FleetExecutor
+{
+private:
+	//Block of machines owned by one worker at a time; aligned so shards do not share cache lines
+	struct alignas(64) FleetShard
+	{
+		DrydockFleet fleet;
+		std::vector<unsigned> targets; //machine index within the shard of each queued event
+		std::vector<DrydockEvent> events;
+		unsigned long long accepted = 0;
+		std::atomic<bool> claimed{ false };
+
+		FleetShard(unsigned machines) : fleet(machines) {}
+	};
+
+	std::vector<FleetShard*> shards;
+	std::vector<std::thread> workers;
+	unsigned shardSize = 1;
+	unsigned machineCount = 0;
+	std::atomic<unsigned long long> stolen{ 0 };
+
+	//Round synchronisation; only touched once per run(), never per event
+	std::mutex roundMutex;
+	std::condition_variable roundStart;
+	std::condition_variable roundDone;
+	unsigned round = 0;
+	unsigned finishedWorkers = 0;
+	bool stopping = false;
+
+	//Claims a shard and applies all its queued events, returning false if it was already claimed or has no events
+	//Parametres:
+		//(index) index of the shard
+	bool tryRun(unsigned index)
+	{
+		FleetShard* shard = this->shards[index];
+		if (shard->claimed.exchange(true, std::memory_order_acquire) || shard->events.empty()) return false;
+
+		unsigned long long accepted = 0;
+		for (size_t i = 0; i < shard->events.size(); i++)
+			accepted += shard->fleet.apply(shard->targets[i], shard->events[i].kind, shard->events[i].payload);
+		shard->accepted += accepted;
+		shard->targets.clear();
+		shard->events.clear();
+		return true;
+	}
+
+	//Worker thread body; processes home shards then steals from the others, once per round
+	//Parametres:
+		//(worker) index of the worker
+	void work(unsigned worker)
+	{
+		unsigned seenRound = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(this->roundMutex);
+				this->roundStart.wait(lock, [&] { return this->stopping || this->round != seenRound; });
+				if (this->stopping) return;
+				seenRound = this->round;
+			}
+
+			unsigned count = unsigned(this->shards.size());
+			unsigned workerCount = unsigned(this->workers.size());
+			for (unsigned i = worker; i < count; i += workerCount) this->tryRun(i);
+			for (unsigned k = 1; k < count; k++)
+			{
+				unsigned i = (worker + k) % count;
+				if (i % workerCount != worker && this->tryRun(i)) this->stolen.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(this->roundMutex);
+				this->finishedWorkers++;
+			}
+			this->roundDone.notify_one();
+		}
+	}
+public:
+	//Parametres:
+		//(machines) number of Drydocks in the fleet
+		//(shardCount) number of shards the machines are split into
+		//(workerCount) number of worker threads
+	FleetExecutor(unsigned machines, unsigned shardCount, unsigned workerCount)
+	{
+		if (shardCount == 0) shardCount = 1;
+		if (workerCount == 0) workerCount = 1;
+		this->machineCount = machines;
+		this->shardSize = (machines + shardCount - 1) / shardCount;
+		if (this->shardSize == 0) this->shardSize = 1;
+		for (unsigned first = 0; first < machines; first += this->shardSize)
+			this->shards.push_back(new FleetShard(std::min(this->shardSize, machines - first)));
+
+		this->workers.reserve(workerCount);
+		for (unsigned i = 0; i < workerCount; i++) this->workers.push_back(std::thread(&FleetExecutor::work, this, i));
+	}
+
+	~FleetExecutor(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->roundMutex);
+			this->stopping = true;
+		}
+		this->roundStart.notify_all();
+		for (std::thread& worker : this->workers) worker.join();
+		for (unsigned i = 0; i < this->shards.size(); i++) delete this->shards[i];
+	}
+
+	//Queues an event for a machine; called from a single producer thread while no run() is in progress
+	//Parametres:
+		//(machine) index of the machine
+		//(kind) enumeration of the event
+		//(payload) integer argument of the event
+	void submit(unsigned machine, event kind, int payload)
+	{
+		FleetShard* shard = this->shards[machine / this->shardSize];
+		shard->targets.push_back(machine % this->shardSize);
+		shard->events.push_back({ kind, payload });
+	}
+
+	//Applies every queued event across the workers and waits until all shards are drained
+	void run(void)
+	{
+		for (FleetShard* shard : this->shards) shard->claimed.store(false, std::memory_order_relaxed);
+		std::unique_lock<std::mutex> lock(this->roundMutex);
+		this->finishedWorkers = 0;
+		this->round++;
+		this->roundStart.notify_all();
+		this->roundDone.wait(lock, [&] { return this->finishedWorkers == this->workers.size(); });
+	}
+
+	//Returns the current operating state of a machine
+	//Parametres:
+		//(machine) index of the machine
+	state getState(unsigned machine) { return this->shards[machine / this->shardSize]->fleet.getState(machine % this->shardSize); }
+
+	//Returns desired parametre value of a machine
+	//Parametres:
+		//(machine) index of the machine
+		//(param) enumeration of the parametre to get
+	unsigned getParamVal(unsigned machine, parametre param) { return this->shards[machine / this->shardSize]->fleet.getParamVal(machine % this->shardSize, param); }
+
+	//Returns the number of events accepted so far
+	unsigned long long getAccepted(void)
+	{
+		unsigned long long accepted = 0;
+		for (FleetShard* shard : this->shards) accepted += shard->accepted;
+		return accepted;
+	}
+
+	//Returns the number of shards processed by a worker other than their home worker
+	unsigned long long getStolen(void) { return this->stolen.load(std::memory_order_relaxed); }
+
+	//Returns the number of machines in the fleet
+	unsigned size(void) { return this->machineCount; }
+};
+#pragma endregion
+
+#pragma region Event ingress
+//Bounded lock-free multi-producer single-consumer queue of Drydock events
+//Each cell carries a sequence number, so a producer claims a slot with one CAS and publishes it with one store;
+//producers never wait on each other or on the consumer, and a full queue makes tryPush() fail instead of blocking
+class EventQueue
+{
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		DrydockEvent event;
+	};
+
+	Cell* cells = nullptr;
+	size_t mask = 0;
+	alignas(64) std::atomic<size_t> enqueuePos{ 0 };
+	alignas(64) size_t dequeuePos = 0; //only touched by the consumer
+public:
+	//Parametres:
+		//(capacity) minimum number of events the queue can hold (rounded up to a power of two)
+	EventQueue(unsigned capacity)
+	{
+		size_t size = 2;
+		while (size < capacity) size <<= 1;
+		this->cells = new Cell[size];
+		this->mask = size - 1;
+		for (size_t i = 0; i < size; i++) this->cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	~EventQueue(void) { delete[] this->cells; }
+
+	//Queues an event from any producer thread, returning false if the queue is full
+	//Parametres:
+		//(nEvent) event to queue
+	bool tryPush(const DrydockEvent& nEvent)
+	{
+		size_t pos = this->enqueuePos.load(std::memory_order_relaxed);
+		while (true)
+		{
+			Cell& cell = this->cells[pos & this->mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t difference = intptr_t(sequence) - intptr_t(pos);
+			if (difference == 0)
+			{
+				if (this->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					cell.event = nEvent;
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0) return false;
+			else pos = this->enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	//Takes the oldest published event; consumer thread only
+	//Parametres:
+		//(nEvent) receives the event
+	bool tryPop(DrydockEvent& nEvent)
+	{
+		Cell& cell = this->cells[this->dequeuePos & this->mask];
+		if (cell.sequence.load(std::memory_order_acquire) != this->dequeuePos + 1) return false;
+		nEvent = cell.event;
+		cell.sequence.store(this->dequeuePos + this->mask + 1, std::memory_order_release);
+		this->dequeuePos++;
+		return true;
+	}
+};
+
+//Lock-free ingress in front of a Drydock
+//Any number of producers (component suppliers, energy grid, order desk) submit events concurrently without blocking,
+//and a single consumer thread applies them to the Drydock one at a time, in the order they were queued
+class DrydockIngress
+{
+private:
+	Drydock* drydock = nullptr;
+	EventQueue queue;
+	unsigned long long accepted = 0;
+public:
+	//Parametres:
+		//(target) Drydock the events are applied to; must only be driven by the consumer thread
+		//(capacity) minimum number of events that can be queued
+	DrydockIngress(Drydock* target, unsigned capacity = 65536) : queue(capacity) { this->drydock = target; }
+
+	//Queues an event from any producer thread, returning false if the ingress is full
+	//Parametres:
+		//(kind) enumeration of the event
+		//(payload) integer argument of the event
+	bool submit(event kind, int payload) { return this->queue.tryPush({ kind, payload }); }
+
+	//Applies queued events to the Drydock; consumer thread only
+	//Returns the number of events applied
+	//Parametres:
+		//(maxEvents) maximum number of events to apply (defaulted as all queued events)
+	unsigned drain(unsigned maxEvents = 0xFFFFFFFF)
+	{
+		unsigned applied = 0;
+		DrydockEvent nEvent;
+		while (applied < maxEvents && this->queue.tryPop(nEvent))
+		{
+			this->accepted += this->drydock->apply(nEvent);
+			applied++;
+		}
+		return applied;
+	}
+
+	//Returns the number of applied events the Drydock accepted
+	unsigned long long getAccepted(void) { return this->accepted; }
+};
+#pragma endregion
+
+#pragma region Concurrent Drydock
+//Drydock whose resources are accounted with atomics, so any number of supplier threads can top up components and energy
+//while builder threads reserve and launch ships, without a mutex
+//Deposits are lock-free: each reserves room under its resource's limit with a CAS on a running total, then is one
+//fetch_add on a per-resource counter with its own cache line
+//The state, the configuration being built, the components and the energy live in one packed 64-bit word; a build
+//reservation or launch folds the deposits made so far into the word and applies its change with a single CAS
+//Unlike the reference Drydock, resources are running totals: deposits add up and are accepted in every state, and a
+//build's components and energy are taken when it is reserved; a deposit that would take the totals past 2^24-1
+//components or 2^32-1 energy, which is all the packed word holds, is rejected
+class ConcurrentDrydock
+{
+private:
+	static constexpr unsigned long long energyMask = 0xFFFFFFFFull; //bits 0-31
+	static constexpr unsigned long long componentMask = 0xFFFFFFull; //bits 32-55
+	static constexpr unsigned long long configMask = 0x3Full; //bits 56-61, state in bits 62-63
+	static_assert(shipCount <= 7 && weaponCount <= 7, "the packed config field holds ship index + 1 and weapon index + 1 in 3 bits each");
+
+	alignas(64) std::atomic<unsigned long long> word{ 0 };
+	alignas(64) std::atomic<unsigned long long> componentDeposits{ 0 };
+	alignas(64) std::atomic<unsigned long long> energyDeposits{ 0 };
+	alignas(64) std::atomic<unsigned long long> componentsHeld{ 0 }; //packed plus deposited, plus any being folded in
+	alignas(64) std::atomic<unsigned long long> energyHeld{ 0 };
+	alignas(64) std::atomic<unsigned long long> retries{ 0 };
+
+	static unsigned long long pack(state nState, unsigned config, unsigned long long components, unsigned long long energy)
+	{
+		return (unsigned long long)nState << 62 | (unsigned long long)config << 56 | components << 32 | energy;
+	}
+	static state stateOf(unsigned long long packed) { return state(packed >> 62); }
+	static unsigned configOf(unsigned long long packed) { return unsigned(packed >> 56 & configMask); }
+	static unsigned long long componentsOf(unsigned long long packed) { return packed >> 32 & componentMask; }
+	static unsigned long long energyOf(unsigned long long packed) { return packed & energyMask; }
+
+	//Returns the state of a Drydock that is not launching a ship
+	//Parametres:
+		//(components) components held
+		//(energy) energy held
+	static state restingState(unsigned long long components, unsigned long long energy)
+	{
+		if (components == 0) return Out_Of_Components;
+		return energy == 0 ? No_Energy : Has_Energy;
+	}
+
+	//Takes the deposits made so far off a counter, skipping the read-modify-write when there are none
+	//Parametres:
+		//(deposits) counter to take the deposits from
+	static unsigned long long takeDeposits(std::atomic<unsigned long long>& deposits)
+	{
+		return deposits.load(std::memory_order_relaxed) ? deposits.exchange(0, std::memory_order_acquire) : 0;
+	}
+
+	//Reserves room for a deposit, so that folding it into the packed word cannot overflow its field
+	//Parametres:
+		//(held) running total of the resource
+		//(amount) amount to deposit
+		//(limit) largest total the packed word can hold
+	static bool reserve(std::atomic<unsigned long long>& held, unsigned long long amount, unsigned long long limit)
+	{
+		unsigned long long current = held.load(std::memory_order_relaxed);
+		do
+		{
+			if (current + amount > limit) return false;
+		} while (!held.compare_exchange_weak(current, current + amount, std::memory_order_acquire, std::memory_order_relaxed));
+		return true;
+	}
+
+	//Folds the deposits into the packed word and applies a change to it, one CAS per attempt
+	//The deposits are folded in even if the change is refused
+	//Parametres:
+		//(decide) given the state, configuration, components and energy with the deposits folded in, returns whether the
+			//change is made and, if so, sets the new packed word
+	template<class Decide> bool commit(Decide decide)
+	{
+		unsigned long long components = takeDeposits(this->componentDeposits);
+		unsigned long long energy = takeDeposits(this->energyDeposits);
+		unsigned long long current = this->word.load(std::memory_order_acquire);
+		while (true)
+		{
+			state nState = stateOf(current);
+			unsigned long long c = componentsOf(current) + components; //within the fields, as reserve() admitted them
+			unsigned long long e = energyOf(current) + energy;
+			unsigned long long next = pack(nState == Launching_Ship ? nState : restingState(c, e), configOf(current), c, e);
+			bool accepted = decide(nState, c, e, next);
+			if (next == current || this->word.compare_exchange_weak(current, next, std::memory_order_acq_rel, std::memory_order_acquire)) return accepted;
+			this->retries.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+public:
+	//Adds components from any thread
+	//Parametres:
+		//(components) amount of components to supply; non-positive amounts, and amounts that would take the total past
+			//2^24-1, are rejected
+	bool supplyComponents(int components)
+	{
+		if (components <= 0 || !reserve(this->componentsHeld, (unsigned long long)components, componentMask)) return false;
+		this->componentDeposits.fetch_add((unsigned long long)components, std::memory_order_release);
+		return true;
+	}
+
+	//Adds energy from any thread
+	//Parametres:
+		//(energy) energy to be transferred; non-positive amounts, and amounts that would take the total past 2^32-1, are
+			//rejected
+	bool transferEnergy(int energy)
+	{
+		if (energy <= 0 || !reserve(this->energyHeld, (unsigned long long)energy, energyMask)) return false;
+		this->energyDeposits.fetch_add((unsigned long long)energy, std::memory_order_release);
+		return true;
+	}
+
+	//Reserves a build, taking its components and energy, if no ship is launching and the resources cover it
+	//Parametres:
+		//(option) selection value to indicate the ship configuration desired
+	bool makeSelection(int option)
+	{
+		OptionCost selection = decodeOption(option);
+		if (!selection.valid) return false;
+		unsigned config = unsigned((selection.shipIndex + 1) * 8 + selection.weaponIndex + 1); //as ShipConfig; 0 is no ship
+		bool reserved = this->commit([&](state nState, unsigned long long c, unsigned long long e, unsigned long long& next) {
+			if (nState == Launching_Ship || c < selection.componentsNeeded || e < selection.cost) return false;
+			next = pack(Launching_Ship, config, c - selection.componentsNeeded, e - selection.cost);
+			return true;
+		});
+		if (!reserved) return false;
+
+		//release the room the build took for later deposits (after the CAS, so a deposit made into it is folded after it)
+		this->componentsHeld.fetch_sub(selection.componentsNeeded, std::memory_order_release);
+		this->energyHeld.fetch_sub(selection.cost, std::memory_order_release);
+		return true;
+	}
+
+	//Launches the reserved ship, if there is one
+	bool launch(void)
+	{
+		return this->commit([](state nState, unsigned long long c, unsigned long long e, unsigned long long& next) {
+			if (nState != Launching_Ship) return false;
+			next = pack(restingState(c, e), 0, c, e);
+			return true;
+		});
+	}
+
+	//Returns the current operating state, counting deposits not yet folded into the packed word
+	state getState(void)
+	{
+		if (stateOf(this->word.load(std::memory_order_acquire)) == Launching_Ship) return Launching_Ship;
+		return restingState(this->getParamVal(Components), this->getParamVal(Energy));
+	}
+
+	//Returns a parametre, counting deposits not yet folded into the packed word
+	//Parametres:
+		//(param) enumeration of the parametre to get
+	unsigned getParamVal(parametre param)
+	{
+		unsigned long long current = this->word.load(std::memory_order_acquire);
+		if (param == Components) return unsigned(std::min(componentsOf(current) + this->componentDeposits.load(std::memory_order_acquire), componentMask));
+		return unsigned(std::min(energyOf(current) + this->energyDeposits.load(std::memory_order_acquire), energyMask));
+	}
+
+	//Returns the option code of the ship being launched, or 0 if there is none
+	int getLaunchingOption(void)
+	{
+		unsigned config = configOf(this->word.load(std::memory_order_acquire));
+		if (config == 0) return 0;
+		int weapon = int(config % 8) - 1;
+		return shipCatalog[config / 8 - 1].code + (weapon >= 0 ? weaponCatalog[weapon].code : 0);
+	}
+
+	//Returns the number of CAS attempts that lost a race and were retried
+	unsigned long long getRetries(void) { return this->retries.load(std::memory_order_relaxed); }
+};
+#pragma endregion
@@ -0,0 +1,679 @@
+/*
+	Finite state machine (FSM) core definitions
+
+	Notes:
+		State methods of the reference Drydock, the transition table engine, the event journal's file mapping and the
+		build planner
+*/
+
+#include "FSM.h"
+#include "Diagnostics.h"
+
+//Memory-mapped file support for the event journal
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#pragma region OutOfComponents state methods
+//Handles user attempting energy transfer when Drydock is out of components
+//Parametres:
+	//(energy) energy to be transferred to power the Drydock
+bool OutOfComponents::transferEnergy(int energy)
+{
+	//Drydock should block this action since it needs components before it can accept currency
+
+	this->currentContext->report(No_Components_For_Energy);
+	this->currentContext->setState(Out_Of_Components);
+	return false;
+}
+
+//Handles user attempting ship/component selection when Drydock is out of components
+//Parametres:
+	//(option) selection value to indicate the ship configuration desired
+bool OutOfComponents::makeSelection(int option)
+{
+	//Drydock should block this action since it needs components before allowing a selection
+
+	this->currentContext->report(No_Components_For_Selection);
+	this->currentContext->setState(Out_Of_Components);
+	return false;
+}
+
+//Handles user supplying components when Drydock is out of components
+//Parametres:
+	//(components) amount of components to supply
+bool OutOfComponents::supplyComponents(int components)
+{
+	//Drydock should allow this action since it's required to shift the state
+
+	this->currentContext->report(Components_Added, components);
+	this->currentContext->setParamVal(Components, components);
+	this->currentContext->setState(No_Energy);
+	return true;
+}
+
+//Handles user attempting launching ship when Drydock is out of components
+bool OutOfComponents::launch(void)
+{
+	//Drydock should block this action since it needs components before assembling and then launching a ship
+
+	this->currentContext->report(Launch_Unassembled);
+	this->currentContext->setState(Out_Of_Components);
+	return false;
+}
+#pragma endregion
+
+#pragma region NoEnergy state methods
+//Handles user attempting energy transfer when Drydock has no energy
+//Parametres:
+	//(energy) energy to be transferred to power the Drydock
+bool NoEnergy::transferEnergy(int energy)
+{
+	//Drydock should allow this action since it's required to shift the state
+
+	if (energy <= 0)
+	{
+		this->currentContext->report(Invalid_Energy, energy);
+		this->currentContext->setState(No_Energy);
+		return false;
+	}
+
+	this->currentContext->setParamVal(Energy, this->currentContext->getParamVal(Energy) + energy);
+	this->currentContext->report(Energy_Transferred, energy, this->currentContext->getParamVal(Energy));
+	this->currentContext->setState(Has_Energy);
+	return true;
+}
+
+//Handles user attempting ship/component selection when Drydock has no energy
+//Parametres:
+	//(option) selection value to indicate the ship configuration desired
+bool NoEnergy::makeSelection(int option)
+{
+	//Drydock should block this action since it needs energy before allowing a selection
+
+	this->currentContext->report(No_Energy_For_Selection);
+	this->currentContext->setState(No_Energy);
+	return false;
+}
+
+//Handles user supplying components when Drydock has no energy
+//Parametres:
+	//(components) amount of components to supply
+bool NoEnergy::supplyComponents(int components)
+{
+	//Drydock should block this action since it needs energy before allowing more components to be supplied
+
+	this->currentContext->report(No_Energy_For_Components);
+	this->currentContext->setState(No_Energy);
+	return false;
+}
+
+//Handles user attempting launching ship when Drydock has no energy
+bool NoEnergy::launch(void)
+{
+	//Drydock should block this action since it needs energy before assembling and then launching a ship
+
+	this->currentContext->report(Launch_Unassembled);
+	this->currentContext->setState(No_Energy);
+	return false;
+}
+#pragma endregion
+
+#pragma region HasEnergy state methods
+//Handles user attempting energy transfer when Drydock has energy
+//Parametres:
+	//(energy) energy to be transferred to power the Drydock
+bool HasEnergy::transferEnergy(int energy)
+{
+	//Drydock should allow this action since it may be required to allow higher component selection
+
+	if (energy <= 0)
+	{
+		this->currentContext->report(Invalid_Energy, energy);
+		this->currentContext->setState(Has_Energy);
+		return false;
+	}
+
+	this->currentContext->setParamVal(Energy, this->currentContext->getParamVal(Energy) + energy);
+	this->currentContext->report(Energy_Transferred, energy, this->currentContext->getParamVal(Energy));
+	this->currentContext->setState(Has_Energy);
+	return true;
+}
+
+//Handles user attempting ship/component selection when Drydock has energy
+//Parametres:
+	//(option) selection value to indicate the ship configuration desired
+bool HasEnergy::makeSelection(int option)
+{
+	//Drydock should allow this action since it's required to shift the state
+
+	//(1) look up the ship and weapon option codes in the catalog; nothing is constructed until the selection is accepted
+	OptionCost selection = decodeOption(option);
+	if (!selection.valid)
+	{
+		if (option >= (1 << shipCount) && selection.weaponIndex < 0) this->currentContext->report(Invalid_Weapon_Selection, option);
+		else this->currentContext->report(Invalid_Ship_Selection, option);
+		this->currentContext->setState(Has_Energy);
+		return false;
+	}
+	this->currentContext->report(Ship_Selected, option);
+
+	//(2) check if there is enough energy for ship assembly
+	if (selection.cost > this->currentContext->getParamVal(Energy))
+	{
+		this->currentContext->report(Not_Enough_Energy, option);
+		this->currentContext->setState(Has_Energy);
+		return false;
+	}
+
+	//(3) check if there is enough components for ship assembly
+	if (selection.componentsNeeded > this->currentContext->getParamVal(Components))
+	{
+		this->currentContext->report(Not_Enough_Components, option);
+		this->currentContext->setState(Has_Energy);
+		return false;
+	}
+
+	//(4) assemble the accepted ship, scrapping any previous ship that was not undocked (launched or not)
+	Drydock* drydock = (Drydock*)(this->currentContext);
+	delete drydock->launchingShip;
+	drydock->launchingShip = Drydock::assemble(selection);
+	drydock->shipLaunching = false;
+	drydock->launchingConfig = ShipConfig::fromOption(option);
+	this->currentContext->report(Ship_Constructing, option);
+	this->currentContext->setState(Launching_Ship);
+	return true;
+}
+
+//Handles user supplying components when Drydock has energy
+//Parametres:
+	//(components) amount of components to supply
+bool HasEnergy::supplyComponents(int components)
+{
+	//Drydock should allow this action since it may be required to allow better component selection
+
+	this->currentContext->report(Components_Added, components);
+	this->currentContext->setParamVal(Components, components);
+	this->currentContext->setState(Has_Energy);
+	return true;
+}
+
+//Handles user attempting launching ship when Drydock has energy
+bool HasEnergy::launch(void)
+{
+	//Drydock should block this action since it needs selection before assembling and then launching a ship
+
+	this->currentContext->report(Launch_Unassembled);
+	this->currentContext->setState(No_Energy);
+	return false;
+}
+#pragma endregion
+
+#pragma region LaunchingShip state methods
+//Handles user attempting energy transfer when Drydock is launching a ship
+//Parametres:
+	//(energy) energy to be transferred to power the Drydock
+bool LaunchingShip::transferEnergy(int energy)
+{
+	//Drydock should block this action since it is busy
+
+	this->currentContext->report(Busy_Energy);
+	this->currentContext->setState(Launching_Ship);
+	return false;
+}
+
+//Handles user attempting ship/component selection when Drydock is launching a ship
+//Parametres:
+	//(option) selection value to indicate the ship configuration desired
+bool LaunchingShip::makeSelection(int option)
+{
+	//Drydock should block this action since it is busy
+
+	this->currentContext->report(Busy_Selection);
+	this->currentContext->setState(Launching_Ship);
+	return false;
+}
+
+//Handles user supplying components when Drydock is launching a ship
+//Parametres:
+	//(components) amount of components to supply
+bool LaunchingShip::supplyComponents(int components)
+{
+	//Drydock should block this action since it is busy
+
+	this->currentContext->report(Busy_Components);
+	this->currentContext->setState(Launching_Ship);
+	return false;
+}
+
+//Handles user attempting launching ship when Drydock is launching a ship
+bool LaunchingShip::launch(void)
+{
+	//Drydock should allow this action since it's required to shift the state
+
+	//flag that the ship is launching
+	((Drydock*)(this->currentContext))->shipLaunching = true;
+	const ShipConfig& config = ((Drydock*)(this->currentContext))->launchingConfig;
+	this->currentContext->report(Ship_Launching, config.option);
+
+	//update component parametre to reflect the successful construction (makeSelection checked both resources cover the ship)
+	this->currentContext->setParamVal(Components, this->currentContext->getParamVal(Components) - config.getComponentsNeeded());
+
+	//update energy parametre to reflect the successful construction
+	this->currentContext->setParamVal(Energy, this->currentContext->getParamVal(Energy) - config.getCost());
+
+	//check the resultant state of the Drydock
+	if (this->currentContext->getParamVal(Components) <= 0)
+	{
+		//check if Drydock is out of components
+		this->currentContext->report(Components_Exhausted, this->currentContext->getParamVal(Energy));
+		this->currentContext->setParamVal(Energy, 0);
+		this->currentContext->setParamVal(Components, 0); //ensure number of components is not less than 0
+		this->currentContext->setState(Out_Of_Components);
+	}
+	else if (this->currentContext->getParamVal(Components) > 0 && this->currentContext->getParamVal(Energy) <= 0)
+	{
+		//else check if Drydock has no energy left
+		this->currentContext->setParamVal(Energy, 0); //ensure energy is not less than 0
+		this->currentContext->setState(No_Energy);
+	}
+	else if (this->currentContext->getParamVal(Components) > 0 && this->currentContext->getParamVal(Energy) > 0)
+	{
+		//else ensure if Drydock has both surplus components and energy remainingsd
+		this->currentContext->setState(Has_Energy);
+	}
+
+	//print remaining resources
+	this->currentContext->report(Resources_Remaining, this->currentContext->getParamVal(Components), this->currentContext->getParamVal(Energy));
+	return true;
+}
+#pragma endregion
+
+#pragma region Transition table engine
+//Rejects an event that is invalid in the current state
+bool Drydock::reject(Drydock* dock, int payload, state& next) { return false; }
+
+//Sets the Components parametre (OutOfComponents/HasEnergy::supplyComponents)
+bool Drydock::supply(Drydock* dock, int payload, state& next)
+{
+	dock->setParamVal(Components, payload);
+	return true;
+}
+
+//Adds to the Energy parametre if the amount is valid (NoEnergy/HasEnergy::transferEnergy)
+bool Drydock::transfer(Drydock* dock, int payload, state& next)
+{
+	if (payload <= 0)
+	{
+		next = state(dock->stateIndex);
+		return false;
+	}
+	dock->setParamVal(Energy, dock->getParamVal(Energy) + payload);
+	return true;
+}
+
+//Assembles the selected ship if the option code, energy and components allow it (HasEnergy::makeSelection)
+bool Drydock::select(Drydock* dock, int payload, state& next)
+{
+	OptionCost selection = decodeOption(payload);
+	if (!selection.valid || selection.cost > dock->getParamVal(Energy) || selection.componentsNeeded > dock->getParamVal(Components)) return false;
+
+	delete dock->launchingShip;
+	dock->launchingShip = assemble(selection);
+	dock->shipLaunching = false;
+	dock->launchingConfig = ShipConfig::fromOption(payload);
+	next = Launching_Ship;
+	return true;
+}
+
+//Launches the assembled ship and resolves the resultant state (LaunchingShip::launch)
+bool Drydock::launchShip(Drydock* dock, int payload, state& next)
+{
+	dock->shipLaunching = true;
+
+	dock->setParamVal(Components, dock->getParamVal(Components) - dock->launchingConfig.getComponentsNeeded());
+	dock->setParamVal(Energy, dock->getParamVal(Energy) - dock->launchingConfig.getCost());
+
+	if (dock->getParamVal(Components) <= 0)
+	{
+		dock->setParamVal(Energy, 0);
+		dock->setParamVal(Components, 0);
+		next = Out_Of_Components;
+	}
+	else if (dock->getParamVal(Energy) <= 0)
+	{
+		dock->setParamVal(Energy, 0);
+		next = No_Energy;
+	}
+	else next = Has_Energy;
+	return true;
+}
+
+//Constructs the Ship (with Weapon if present) of a valid decoded option code
+//Parametres:
+	//(selection) decoded option code; must be valid
+Ship* Drydock::assemble(const OptionCost& selection)
+{
+	Ship* ship = static_cast<Ship*>(shipCatalog[selection.shipIndex].make());
+	if (selection.weaponIndex >= 0) ship->addWeapon(static_cast<Weapon*>(weaponCatalog[selection.weaponIndex].make()));
+	return ship;
+}
+
+//Rows are indexed by state, columns by event (Transfer_Energy, Make_Selection, Supply_Components, Launch_Ship)
+const Drydock::TransitionEntry Drydock::transitionTable[stateCount][eventCount] =
+{
+	//Out_Of_Components
+	{ { reject, Out_Of_Components }, { reject, Out_Of_Components }, { supply, No_Energy }, { reject, Out_Of_Components } },
+	//No_Energy
+	{ { transfer, Has_Energy }, { reject, No_Energy }, { reject, No_Energy }, { reject, No_Energy } },
+	//Has_Energy
+	{ { transfer, Has_Energy }, { select, Has_Energy }, { supply, Has_Energy }, { reject, No_Energy } },
+	//Launching_Ship
+	{ { reject, Launching_Ship }, { reject, Launching_Ship }, { reject, Launching_Ship }, { launchShip, Launching_Ship } }
+};
+#pragma endregion
+
+#pragma region Event journal
+//Platform file handling of DrydockJournal; the record layout and appending stay inline in FSM.h
+size_t DrydockJournal::pageSize(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return size_t(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+bool DrydockJournal::map(unsigned long long newCapacity)
+{
+	unsigned long long size = fileSize(newCapacity);
+#ifdef _WIN32
+	this->mapping = CreateFileMappingA(HANDLE(this->file), nullptr, PAGE_READWRITE, DWORD(size >> 32), DWORD(size), nullptr);
+	if (!this->mapping) return false;
+	this->view = (unsigned char*)MapViewOfFile(this->mapping, FILE_MAP_WRITE, 0, 0, SIZE_T(size));
+	if (!this->view)
+	{
+		CloseHandle(this->mapping);
+		this->mapping = nullptr;
+		return false;
+	}
+#else
+	if (ftruncate(int(this->file), off_t(size)) != 0) return false;
+#ifdef MAP_POPULATE
+	const int flags = MAP_SHARED | MAP_POPULATE; //fault the pages in now rather than on the first append to each
+#else
+	const int flags = MAP_SHARED;
+#endif
+	void* mapped = mmap(nullptr, size_t(size), PROT_READ | PROT_WRITE, flags, int(this->file), 0);
+	if (mapped == MAP_FAILED) return false;
+	this->view = (unsigned char*)mapped;
+#endif
+	this->header = (JournalHeader*)this->view;
+	this->records = (JournalRecord*)(this->view + sizeof(JournalHeader));
+	this->capacity = newCapacity;
+	return true;
+}
+
+void DrydockJournal::unmap(void)
+{
+	if (!this->view) return;
+#ifdef _WIN32
+	UnmapViewOfFile(this->view);
+	CloseHandle(this->mapping);
+	this->mapping = nullptr;
+#else
+	munmap(this->view, size_t(fileSize(this->capacity)));
+#endif
+	this->view = nullptr;
+	this->header = nullptr;
+	this->records = nullptr;
+	this->capacity = 0;
+}
+
+DrydockJournal::DrydockJournal(const string& path, unsigned syncInterval, unsigned long long initialCapacity) : syncInterval(max(1u, syncInterval))
+{
+	unsigned long long existingSize = 0;
+#ifdef _WIN32
+	this->file = intptr_t(CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+	if (HANDLE(this->file) == INVALID_HANDLE_VALUE) return;
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(HANDLE(this->file), &size)) existingSize = size.QuadPart;
+#else
+	this->file = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (this->file < 0) return;
+	struct stat info;
+	if (fstat(int(this->file), &info) == 0) existingSize = info.st_size;
+#endif
+	unsigned long long existingRecords = existingSize > sizeof(JournalHeader) ? (existingSize - sizeof(JournalHeader)) / sizeof(JournalRecord) : 0;
+	if (!this->map(max(max(initialCapacity, existingRecords), 1ull))) return;
+
+	if (memcmp(this->header->magic, "DRYDOCKJ", 8) == 0 && this->header->recordSize == sizeof(JournalRecord))
+	{
+		//continue after the last complete record of an existing journal
+		this->count = min(this->header->records, existingRecords);
+	}
+	else
+	{
+		memcpy(this->header->magic, "DRYDOCKJ", 8);
+		this->header->recordSize = sizeof(JournalRecord);
+		this->header->version = 1;
+		this->count = 0;
+	}
+	this->header->records = this->count;
+	this->syncedCount = this->count;
+	this->durableCount = this->count;
+}
+
+void DrydockJournal::sync(bool wait)
+{
+	unsigned long long first = wait ? this->durableCount : this->syncedCount;
+	if (!this->view || first == this->count) return;
+	size_t page = pageSize();
+	size_t begin = size_t(fileSize(first)) / page * page;
+	size_t end = size_t(fileSize(this->count));
+#ifdef _WIN32
+	FlushViewOfFile(this->view + begin, end - begin);
+	FlushViewOfFile(this->view, sizeof(JournalHeader));
+	if (wait) FlushFileBuffers(HANDLE(this->file));
+#else
+	msync(this->view + begin, end - begin, wait ? MS_SYNC : MS_ASYNC);
+	if (begin > 0) msync(this->view, page, wait ? MS_SYNC : MS_ASYNC);
+#endif
+	this->syncedCount = this->count;
+	if (wait) this->durableCount = this->count;
+}
+
+void DrydockJournal::close(void)
+{
+	if (this->view)
+	{
+		this->flush();
+		this->unmap();
+	}
+	if (this->file == -1) return;
+#ifdef _WIN32
+	LARGE_INTEGER size;
+	size.QuadPart = LONGLONG(fileSize(this->count));
+	if (SetFilePointerEx(HANDLE(this->file), size, nullptr, FILE_BEGIN)) SetEndOfFile(HANDLE(this->file));
+	CloseHandle(HANDLE(this->file));
+#else
+	ftruncate(int(this->file), off_t(fileSize(this->count)));
+	::close(int(this->file));
+#endif
+	this->file = -1;
+}
+#pragma endregion
+
+#pragma region Build planner
+//Chooses the orders that maximise the number of launches within a Components/Energy budget
+//Every order needs 1 (no weapon) or 2 (with weapon) components, so an optimal plan takes the cheapest (k1) single-component
+//orders and the cheapest (k2) two-component orders; (k2) is scanned and the largest affordable (k1) found for each,
+//preferring the plan that uses the least energy among those with the most launches
+//Orders are bucketed by catalog configuration, so planning is linear in the number of orders
+//Parametres:
+	//(components) Components budget
+	//(energy) Energy budget
+	//(demand) pointer to the first candidate option code
+	//(count) number of candidate option codes
+BuildPlan Drydock::planBuilds(unsigned components, unsigned energy, const int* demand, unsigned count)
+{
+	const int configurations = shipCount * (weaponCount + 1);
+
+	//bucket valid orders by configuration (entry index = ship * (weaponCount + 1) + weapon + 1)
+	vector<unsigned> bucketSizes(configurations, 0);
+	vector<int> configuration(count, -1);
+	for (unsigned i = 0; i < count; i++)
+	{
+		OptionCost selection = decodeOption(demand[i]);
+		if (!selection.valid) continue;
+		configuration[i] = selection.shipIndex * (weaponCount + 1) + selection.weaponIndex + 1;
+		bucketSizes[configuration[i]]++;
+	}
+
+	//order each group's configurations by cost and build prefix sums of the cheapest orders
+	vector<unsigned long long> cheapest[2];
+	vector<int> groupOrder[2];
+	for (int entry = 0; entry < configurations; entry++) groupOrder[entry % (weaponCount + 1) == 0 ? 0 : 1].push_back(entry);
+	for (int group = 0; group < 2; group++)
+	{
+		sort(groupOrder[group].begin(), groupOrder[group].end(), [](int a, int b) {
+			return optionTable.entries[a / (weaponCount + 1)][a % (weaponCount + 1)].cost < optionTable.entries[b / (weaponCount + 1)][b % (weaponCount + 1)].cost; });
+		cheapest[group].push_back(0);
+		for (int entry : groupOrder[group])
+		{
+			unsigned long long cost = optionTable.entries[entry / (weaponCount + 1)][entry % (weaponCount + 1)].cost;
+			for (unsigned n = 0; n < bucketSizes[entry]; n++) cheapest[group].push_back(cheapest[group].back() + cost);
+		}
+	}
+
+	//scan the number of two-component orders, taking as many single-component orders as still fit
+	size_t bestSingles = 0, bestDoubles = 0;
+	unsigned long long bestEnergy = 0;
+	size_t singles = cheapest[0].size() - 1;
+	for (size_t doubles = 0; doubles < cheapest[1].size() && 2ull * doubles <= components && cheapest[1][doubles] <= energy; doubles++)
+	{
+		singles = min<size_t>(singles, components - 2 * doubles);
+		while (singles > 0 && cheapest[1][doubles] + cheapest[0][singles] > energy) singles--;
+		unsigned long long used = cheapest[1][doubles] + cheapest[0][singles];
+		if (singles + doubles > bestSingles + bestDoubles || (singles + doubles == bestSingles + bestDoubles && used < bestEnergy))
+		{
+			bestSingles = singles;
+			bestDoubles = doubles;
+			bestEnergy = used;
+		}
+	}
+
+	//work out how many orders of each configuration the plan takes, cheapest first
+	vector<unsigned> taken(configurations, 0);
+	size_t wanted[2] = { bestSingles, bestDoubles };
+	for (int group = 0; group < 2; group++)
+	{
+		for (int entry : groupOrder[group])
+		{
+			unsigned n = unsigned(min<size_t>(wanted[group], bucketSizes[entry]));
+			taken[entry] = n;
+			wanted[group] -= n;
+		}
+	}
+
+	//emit the chosen orders in demand order
+	BuildPlan plan;
+	plan.options.reserve(bestSingles + bestDoubles);
+	for (unsigned i = 0; i < count; i++)
+	{
+		if (configuration[i] < 0 || taken[configuration[i]] == 0) continue;
+		taken[configuration[i]]--;
+		plan.options.push_back(demand[i]);
+	}
+	plan.componentsUsed = unsigned(bestSingles + 2 * bestDoubles);
+	plan.energyUsed = bestEnergy;
+	return plan;
+}
+
+//Plans builds against the Drydock's current Components and Energy
+//Only a Drydock that has energy can take a selection, so the plan is empty in any other state
+//Parametres:
+	//(demand) candidate option codes
+BuildPlan Drydock::planBuilds(const vector<int>& demand)
+{
+	if (this->stateIndex != Has_Energy) return BuildPlan();
+	return planBuilds(this->getParamVal(Components), this->getParamVal(Energy), demand.data(), unsigned(demand.size()));
+}
+
+//Executes a plan as select/launch event pairs through the transition table, undocking each ship launched
+//Execution stops at the first selection the Drydock rejects (launching without a ship would drop it to No_Energy),
+//so the result holds one code per event applied and a fully executed plan has twice as many codes as orders
+//Parametres:
+	//(plan) plan returned by planBuilds()
+	//(ships) optional output the undocked ships are appended to; otherwise they are released
+DrydockBatchResult Drydock::executePlan(const BuildPlan& plan, vector<ShipHandle>* ships)
+{
+	DrydockBatchResult result;
+	result.results.reserve(plan.options.size() * 2);
+	for (int option : plan.options)
+	{
+		bool selected = this->dispatch(Make_Selection, option);
+		this->journalEvent(Make_Selection, option, selected);
+		result.results.push_back(selected ? Event_Accepted : Event_Rejected);
+		if (!selected) break;
+
+		bool launched = this->dispatch(Launch_Ship, 0);
+		this->journalEvent(Launch_Ship, 0, launched);
+		result.results.push_back(launched ? Event_Accepted : Event_Rejected);
+		ShipHandle ship = this->undockShip();
+		if (ships && ship) ships->push_back(move(ship));
+	}
+
+	result.finalState = state(this->stateIndex);
+	result.components = this->getParamVal(Components);
+	result.energy = this->getParamVal(Energy);
+	return result;
+}
+#pragma endregion
+
+#pragma region Diagnostics sinks
+//Writes a diagnostic as the line of text the Drydock states used to print
+//Parametres:
+	//(out) stream to write to
+	//(record) diagnostic to format
+void formatDiagnostic(ostream& out, const Diagnostic& record)
+{
+	switch (record.code)
+	{
+	case No_Components_For_Energy: out << "ERROR: cannot accept energy due to the absence of components"; break;
+	case No_Components_For_Selection: out << "ERROR: cannot select component due to the absence of components"; break;
+	case Components_Added: out << "Components added: " << record.first; break;
+	case Launch_Unassembled: out << "ERROR: cannot launch an unassembled ship"; break;
+	case Invalid_Energy: out << "ERROR: invalid amount of energy supplied"; break;
+	case Energy_Transferred: out << "Energy transferred: " << record.first << ", total: " << record.second; break;
+	case No_Energy_For_Selection: out << "ERROR: cannot select component due to the absence of energy"; break;
+	case No_Energy_For_Components: out << "ERROR: cannot accept component supply due to the absence of energy"; break;
+	case Invalid_Weapon_Selection: out << "ERROR: weapon selection invalid"; break;
+	case Invalid_Ship_Selection: out << "ERROR: ship selection invalid"; break;
+	case Ship_Selected: out << "Selected: " << Drydock::getOptionName(int(record.first)); break;
+	case Not_Enough_Energy: out << "ERROR: not enough energy available to construct " << Drydock::getOptionName(int(record.first)); break;
+	case Not_Enough_Components: out << "ERROR: not enough components available to construct " << Drydock::getOptionName(int(record.first)); break;
+	case Ship_Constructing: out << "Constructing: " << Drydock::getOptionName(int(record.first)); break;
+	case Busy_Energy: out << "ERROR: cannot accept energy since Drydock is currently busy"; break;
+	case Busy_Selection: out << "ERROR: cannot select component since Drydock is currently busy"; break;
+	case Busy_Components: out << "ERROR: cannot accept component supply since Drydock is currently busy"; break;
+	case Ship_Launching: out << "Launching: " << Drydock::getOptionName(int(record.first)); break;
+	case Components_Exhausted: out << "ALERT: Drydock has ran out of components - using " << record.first << " energy to shut down operations"; break;
+	case Resources_Remaining: out << "Components remaining: " << record.first << "\nEnergy remaining: " << record.second; break;
+	case No_Ship_Assembled: out << "ERROR: no ship assembled"; break;
+	}
+	out << '\n';
+}
+#pragma endregion
@@ -0,0 +1,1728 @@
+#pragma once
+
+/*
+	Finite state machine (FSM) core
+
+	Notes:
+		StateContext, the Drydock and its states, ship components and their catalog, and the event journal
+		Out-of-line definitions (state methods, transition table engine, build planner) are in FSM.cpp,
+		which is built as the fsm library (see CMakeLists.txt)
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <variant>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <fstream>
+#include <cstring>
+
+//Define FSM_PORTABLE to 1 to build the portable fallbacks in place of the x86 intrinsics, even on x86
+#ifndef FSM_PORTABLE
+#define FSM_PORTABLE 0
+#endif
+
+#if !FSM_PORTABLE && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#define FSM_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FSM_TARGET_AVX2
+#else
+#define FSM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define FSM_X86 0
+#endif
+
+//Set FSM_DIAGNOSTICS to 0 to compile diagnostics reporting out of the state handlers entirely
+//(the CMake build sets it for the fsm library and everything linked against it)
+#ifndef FSM_DIAGNOSTICS
+#define FSM_DIAGNOSTICS 1
+#endif
+
+//Set FSM_INSTRUMENTATION to 1 to count every transition and sample event latencies (see TransitionMetrics)
+//FSM_LATENCY_SAMPLING sets how many events pass per timed event, on average
+#ifndef FSM_INSTRUMENTATION
+#define FSM_INSTRUMENTATION 0
+#endif
+#ifndef FSM_LATENCY_SAMPLING
+#define FSM_LATENCY_SAMPLING 64
+#endif
+
+#pragma region Enumerations
+//Possible states the Drydock can operate in:
+	//(Out_Of_Components) Drydock has no components for ship assembly
+	//(No_Energy) Drydock has no energy for ship assembly
+	//(Has_Energy) Drydock has energy and can assembly a ship
+	//(Launching_Ship) Drydock has assembled a ship, which then needs launching
+enum state { Out_Of_Components, No_Energy, Has_Energy, Launching_Ship };
+
+//Possible parametres the Drydock can operate with
+	//(Components) compoents used for ship assembly
+	//(Energy) power used for conducting a ship assembly
+enum parametre { Components, Energy };
+
+//Number of states and parametres, which size the inline storage of StateContext
+const int stateCount = Launching_Ship + 1;
+const int parametreCount = Energy + 1;
+
+//Possible events the Drydock can be driven with (mirrors the Transition methods)
+	//(Transfer_Energy) energy is transferred to the Drydock
+	//(Make_Selection) a ship configuration is selected for assembly
+	//(Supply_Components) components are supplied to the Drydock
+	//(Launch_Ship) the assembled ship is launched
+//The underlying type is fixed so kinds read from outside (batches, scripts, journals) may hold any int and be range checked
+enum event : int { Transfer_Energy, Make_Selection, Supply_Components, Launch_Ship };
+
+//Number of events, which sizes the transition table; event kinds from outside (batches, scripts) must be below it
+const int eventCount = Launch_Ship + 1;
+
+//Possible results of an event applied in a batch
+	//(Event_Rejected) event was invalid in the state it was applied in
+	//(Event_Accepted) event was carried out
+enum eventResult { Event_Rejected, Event_Accepted };
+
+//Ways StateContext::setState() fires the State hooks:
+	//(Every_Transition) State::leave() and State::transition() fire on every setState() call, including those that keep the state
+	//(State_Changes_Only) the hooks fire only when the state actually changes
+enum transitionMode { Every_Transition, State_Changes_Only };
+
+//Journal record kinds that are not Transition events (numbered after the event enumeration)
+	//(Undock_Ship) the launched ship is undocked
+enum journalKind { Undock_Ship = Launch_Ship + 1 };
+
+//Possible diagnostics the Drydock states can report (formatted as text by formatDiagnostic())
+enum diagnostic { No_Components_For_Energy, No_Components_For_Selection, Components_Added, Launch_Unassembled,
+	Invalid_Energy, Energy_Transferred, No_Energy_For_Selection, No_Energy_For_Components, Invalid_Weapon_Selection,
+	Invalid_Ship_Selection, Ship_Selected, Not_Enough_Energy, Not_Enough_Components, Ship_Constructing, Busy_Energy,
+	Busy_Selection, Busy_Components, Ship_Launching, Components_Exhausted, Resources_Remaining, No_Ship_Assembled };
+#pragma endregion 
+
+#pragma region Transition instrumentation
+//Log-linear latency histogram in the style of HdrHistogram: each power of two is split into (subBuckets) buckets,
+//so any recorded value is known to within 1/subBuckets of itself
+struct LatencyHistogram
+{
+	static const int subBucketBits = 3;
+	static const int subBuckets = 1 << subBucketBits;
+	static const int bucketCount = (40 - subBucketBits + 1) * subBuckets; //values up to 2^40 ticks
+
+	unsigned long long counts[bucketCount];
+
+	//Returns the bucket a value is counted in
+	//Parametres:
+		//(value) recorded value
+	static int bucketOf(unsigned long long value)
+	{
+		if (value < (unsigned long long)subBuckets) return int(value);
+		int magnitude = highestBit(value);
+		int bucket = (magnitude - subBucketBits + 1) * subBuckets + int((value >> (magnitude - subBucketBits)) - subBuckets);
+		return std::min(bucket, bucketCount - 1);
+	}
+
+	//Returns the index of the highest set bit of a non-zero value
+	static int highestBit(unsigned long long value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return int(index);
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	//Returns the largest value counted in a bucket
+	//Parametres:
+		//(bucket) index of the bucket
+	static unsigned long long upperBound(int bucket)
+	{
+		if (bucket < subBuckets) return (unsigned long long)bucket;
+		int magnitude = bucket / subBuckets + subBucketBits - 1;
+		unsigned long long width = 1ull << (magnitude - subBucketBits);
+		return (unsigned long long)(subBuckets + bucket % subBuckets) * width + width - 1;
+	}
+};
+
+//Snapshot of the transition counters of every thread (see TransitionMetrics)
+struct TransitionStats
+{
+	unsigned long long transitions[4][4][4]; //events by [from state][event][to state]
+	unsigned long long accepted[4][4]; //accepted events by [from state][event]
+	unsigned long long rejected[4][4]; //rejected events by [from state][event]
+	unsigned long long stateChanges[4][4]; //StateContext::setState() calls by [from state][to state]
+	LatencyHistogram latency[4][4]; //sampled event latencies in ticks by [from state][event]
+	double nsPerTick;
+
+	//Returns the number of events that took the Drydock from one state to another
+	unsigned long long getCount(state from, event nEvent, state to) const { return this->transitions[from][nEvent][to]; }
+
+	//Returns the latency in ns below which the given fraction of the sampled events fell
+	//Parametres:
+		//(from) state the events were applied in
+		//(nEvent) enumeration of the event
+		//(fraction) percentile as a fraction, e.g. 0.99
+	double getLatency(state from, event nEvent, double fraction) const
+	{
+		const LatencyHistogram& histogram = this->latency[from][nEvent];
+		unsigned long long total = 0;
+		for (int b = 0; b < LatencyHistogram::bucketCount; b++) total += histogram.counts[b];
+		if (total == 0) return 0;
+
+		unsigned long long target = (unsigned long long)(fraction * total), seen = 0;
+		for (int b = 0; b < LatencyHistogram::bucketCount; b++)
+		{
+			seen += histogram.counts[b];
+			if (seen > target) return LatencyHistogram::upperBound(b) * this->nsPerTick;
+		}
+		return LatencyHistogram::upperBound(LatencyHistogram::bucketCount - 1) * this->nsPerTick;
+	}
+};
+
+//Process-wide per-transition counters and latency histograms, fed by StateContext when FSM_INSTRUMENTATION is 1
+//Every thread writes only to its own shard with plain relaxed loads and stores, so recording takes no locks and
+//no atomic read-modify-write; snapshot() sums the shards (and those of threads that have exited) under a mutex
+//About one event in every FSM_LATENCY_SAMPLING is timed, with the time-stamp counter where there is one; the gap between
+//timed events is jittered from the tick's low bits so that a periodic event stream is not always sampled at the same event
+class TransitionMetrics
+{
+public:
+	struct Shard
+	{
+		std::atomic<unsigned long long> transitions[4][4][4];
+		std::atomic<unsigned long long> outcomes[4][4][2]; //[from state][event][accepted], indexed rather than branched on
+		std::atomic<unsigned long long> stateChanges[4][4];
+		std::atomic<unsigned long long> latency[4][4][LatencyHistogram::bucketCount];
+		unsigned sampleCountdown = 1;
+
+		Shard(void) { clear(*this); }
+
+		//Returns the current tick if this event's latency is sampled, otherwise 0
+		unsigned long long sampleStart(void)
+		{
+			if (--this->sampleCountdown) return 0;
+			unsigned long long now = ticks();
+			this->sampleCountdown = FSM_LATENCY_SAMPLING / 2 + unsigned(now % FSM_LATENCY_SAMPLING) + 1;
+			return now;
+		}
+
+		//Counts an event applied by the owning thread
+		//Parametres:
+			//(from) state the event was applied in
+			//(nEvent) enumeration of the event
+			//(to) state after the event
+			//(isAccepted) whether the event was accepted
+			//(started) tick returned by sampleStart()
+		void recordEvent(unsigned from, unsigned nEvent, unsigned to, bool isAccepted, unsigned long long started)
+		{
+			bump(this->transitions[from][nEvent][to]);
+			bump(this->outcomes[from][nEvent][isAccepted]);
+			if (started) bump(this->latency[from][nEvent][LatencyHistogram::bucketOf(ticks() - started)]);
+		}
+
+		//Counts a StateContext::setState() call
+		void recordStateChange(unsigned from, unsigned to) { bump(this->stateChanges[from][to]); }
+	};
+private:
+	struct Registry
+	{
+		std::mutex lock;
+		std::vector<Shard*> live;
+		TransitionStats retired; //counts of threads that have exited
+		unsigned long long startTick;
+		std::chrono::steady_clock::time_point startTime;
+	};
+
+	//Owns the calling thread's shard and folds its counts into the registry when the thread exits
+	struct ShardOwner
+	{
+		Shard* shard;
+		ShardOwner(void)
+		{
+			this->shard = new Shard;
+			Registry& r = registry();
+			std::lock_guard<std::mutex> guard(r.lock);
+			r.live.push_back(this->shard);
+		}
+		~ShardOwner(void)
+		{
+			Registry& r = registry();
+			std::lock_guard<std::mutex> guard(r.lock);
+			accumulate(r.retired, *this->shard);
+			r.live.erase(find(r.live.begin(), r.live.end(), this->shard));
+			delete this->shard;
+		}
+	};
+
+	//Creates the calling thread's shard and caches it
+	//Parametres:
+		//(cached) thread_local pointer local() reads the shard through
+	static Shard& attach(Shard*& cached)
+	{
+		thread_local ShardOwner owner;
+		cached = owner.shard;
+		return *cached;
+	}
+
+	//Increments a counter written by a single thread
+	static void bump(std::atomic<unsigned long long>& counter) { counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+	static Registry& registry(void)
+	{
+		static Registry* instance = [] {
+			Registry* r = new Registry; //never destroyed, so threads exiting during shutdown can still fold in their counts
+			memset(&r->retired, 0, sizeof(r->retired));
+			r->startTick = ticks();
+			r->startTime = std::chrono::steady_clock::now();
+			return r;
+		}();
+		return *instance;
+	}
+
+	static void clear(Shard& shard)
+	{
+		for (auto& a : shard.transitions) for (auto& b : a) for (auto& c : b) c.store(0, std::memory_order_relaxed);
+		for (auto& a : shard.outcomes) for (auto& b : a) for (auto& c : b) c.store(0, std::memory_order_relaxed);
+		for (auto& a : shard.stateChanges) for (auto& b : a) b.store(0, std::memory_order_relaxed);
+		for (auto& a : shard.latency) for (auto& b : a) for (auto& c : b) c.store(0, std::memory_order_relaxed);
+	}
+
+	static void accumulate(TransitionStats& stats, const Shard& shard)
+	{
+		for (int f = 0; f < 4; f++)
+		{
+			for (int e = 0; e < 4; e++)
+			{
+				for (int t = 0; t < 4; t++) stats.transitions[f][e][t] += shard.transitions[f][e][t].load(std::memory_order_relaxed);
+				stats.accepted[f][e] += shard.outcomes[f][e][1].load(std::memory_order_relaxed);
+				stats.rejected[f][e] += shard.outcomes[f][e][0].load(std::memory_order_relaxed);
+				for (int b = 0; b < LatencyHistogram::bucketCount; b++) stats.latency[f][e].counts[b] += shard.latency[f][e][b].load(std::memory_order_relaxed);
+			}
+			for (int t = 0; t < 4; t++) stats.stateChanges[f][t] += shard.stateChanges[f][t].load(std::memory_order_relaxed);
+		}
+	}
+public:
+	//Returns a monotonic tick count: the time-stamp counter on x86, otherwise steady clock nanoseconds
+	static unsigned long long ticks(void)
+	{
+#if FSM_X86
+		return __rdtsc();
+#else
+		return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	//Returns the calling thread's shard, creating it on first use
+	//The shard is cached in a trivially initialised thread_local so the hot path skips the owner's initialisation guard
+	static Shard& local(void)
+	{
+		static thread_local Shard* cached = nullptr;
+		if (cached) return *cached;
+		return attach(cached);
+	}
+
+	//Returns the sum of every thread's counters
+	static TransitionStats snapshot(void)
+	{
+		Registry& r = registry();
+		TransitionStats stats;
+		{
+			std::lock_guard<std::mutex> guard(r.lock);
+			stats = r.retired;
+			for (Shard* shard : r.live) accumulate(stats, *shard);
+		}
+		double elapsedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - r.startTime).count();
+		unsigned long long elapsedTicks = ticks() - r.startTick;
+		stats.nsPerTick = elapsedTicks ? elapsedNs / elapsedTicks : 1;
+		return stats;
+	}
+
+	//Zeroes every thread's counters; counts recorded while the reset runs may survive it
+	static void reset(void)
+	{
+		Registry& r = registry();
+		std::lock_guard<std::mutex> guard(r.lock);
+		memset(&r.retired, 0, sizeof(r.retired));
+		for (Shard* shard : r.live) clear(*shard);
+	}
+};
+#pragma endregion
+
+#pragma region Base classes
+class StateContext;
+
+//Base class for other states
+//Used in combination with Transition to form a Drydock operating state
+class State
+{
+protected:
+	StateContext * currentContext;
+public:
+	State(StateContext* context) { this->currentContext = context; }
+	virtual ~State(void) {}
+	virtual void transition(void) {} //entry hook
+	virtual void leave(void) {} //exit hook
+};
+
+//Fixed-size diagnostic record reported by a state
+	//(code) enumeration of the diagnostic
+	//(first) first value of the diagnostic (amount, total or option code, depending on the code)
+	//(second) second value of the diagnostic
+struct Diagnostic
+{
+	diagnostic code;
+	long long first;
+	long long second;
+};
+
+//Base class for receivers of state diagnostics
+//Implementations must not block the reporting state on I/O
+class DiagnosticsSink
+{
+public:
+	virtual ~DiagnosticsSink(void) {}
+	virtual void write(const Diagnostic& record) = 0;
+};
+
+//Decision contexts
+//Facilitates information sharing between state 
+//States and parametres are stored inline (sized by stateCount and parametreCount) rather than in vectors; the fields every
+//event touches are laid out first so that, with the vtable pointer, they share the context's first cache line
+class alignas(64) StateContext
+{
+protected:
+	State * currentState = nullptr;
+	int stateIndex = -1; //no state until the first setState()
+	transitionMode mode = Every_Transition;
+	alignas(8) unsigned parametres[parametreCount] = {}; //8-byte aligned so Components and Energy can be read as one word
+	unsigned long long transitionCount = 0; //setState() calls
+	unsigned long long redundantCount = 0; //setState() calls that kept the current state
+	DiagnosticsSink* diagnostics = nullptr;
+	State* availableStates[stateCount] = {}; //owned; filled in by the derived context's constructor
+public:
+	//State decision context destructor; deletes all available states and the diagnostics sink
+	virtual ~StateContext(void)
+	{
+		delete this->diagnostics;
+
+		//iterate through all available states and release the memory taken by them
+		for (int i = 0; i < stateCount; i++) delete this->availableStates[i];
+	}
+
+	//Allows change of state to be made
+	//Parametres:
+		//(newState) enumeration of the state to change to
+	virtual void setState(state newState)
+	{
+		this->transitionCount++;
+
+		//most rejection paths stay in the state they were handled in, which needs no re-index
+		if (newState == this->stateIndex)
+		{
+#if FSM_INSTRUMENTATION
+			TransitionMetrics::local().recordStateChange(newState, newState);
+#endif
+			this->redundantCount++;
+			if (this->mode == Every_Transition)
+			{
+				this->currentState->leave();
+				this->currentState->transition();
+			}
+			return;
+		}
+
+		if (this->currentState)
+		{
+#if FSM_INSTRUMENTATION
+			TransitionMetrics::local().recordStateChange(this->stateIndex, newState);
+#endif
+			this->currentState->leave();
+		}
+
+		//use newState enum as reference of what state to get as currentState
+		this->currentState = availableStates[newState];
+		this->stateIndex = newState;
+
+		//redundant as individual state transitions are present
+		this->currentState->transition();
+	}
+
+	//Counts a state change made without setState(), as the transition table engine does; no State hooks fire
+	//Parametres:
+		//(from) state the change was made from
+		//(newState) enumeration of the state changed to
+	void countTransition(unsigned from, state newState)
+	{
+#if FSM_INSTRUMENTATION
+		TransitionMetrics::local().recordStateChange(from, newState);
+#endif
+		this->transitionCount++;
+		if (unsigned(newState) == from) this->redundantCount++;
+	}
+
+	//Changes when setState() fires the State hooks
+	//Parametres:
+		//(nMode) enumeration of the transition mode
+	void setTransitionMode(transitionMode nMode) { this->mode = nMode; }
+
+	//Returns when setState() fires the State hooks
+	transitionMode getTransitionMode(void) { return this->mode; }
+
+	//Returns the number of setState() calls made
+	unsigned long long getTransitionCount(void) { return this->transitionCount; }
+
+	//Returns the number of setState() calls that kept the current state (taken without a re-index)
+	unsigned long long getRedundantTransitions(void) { return this->redundantCount; }
+
+	//Returns the current operating state
+	virtual state getState(void) { return state(stateIndex); }
+
+	//Returns the value used to indicate the current state
+	virtual unsigned getStateIndex(void) { return this->stateIndex; }
+
+	//Allows change of parametre value to be made
+	//Parametres:
+		//(param) enumeration of the parametre to set
+		//(value) new value for the enumerated parametre
+	void setParamVal(parametre param, unsigned value)
+	{
+		this->parametres[param] = value;
+	}
+
+	//Returns desired parametre value
+	//Parametres:
+		//(param) enumeration of the parametre to get
+	unsigned getParamVal(parametre param) { return this->parametres[param]; }
+
+	//Replaces the sink that receives diagnostics from the states; StateContext takes ownership of it
+	//Parametres:
+		//(sink) new diagnostics sink, or nullptr to discard diagnostics
+	void setDiagnostics(DiagnosticsSink* sink)
+	{
+		if (sink != this->diagnostics) delete this->diagnostics;
+		this->diagnostics = sink;
+	}
+
+	//Returns the current diagnostics sink (nullptr if diagnostics are discarded)
+	DiagnosticsSink* getDiagnostics(void) { return this->diagnostics; }
+
+	//Starts an instrumented event, returning the tick to pass to endEvent() (0 if its latency is not sampled)
+	unsigned long long beginEvent(void)
+	{
+#if FSM_INSTRUMENTATION
+		return TransitionMetrics::local().sampleStart();
+#else
+		return 0;
+#endif
+	}
+
+	//Counts an applied event and its latency, when instrumentation is compiled in
+	//Parametres:
+		//(from) state the event was applied in
+		//(nEvent) enumeration of the event
+		//(accepted) whether the event was accepted
+		//(started) tick returned by beginEvent()
+	void endEvent(unsigned from, event nEvent, bool accepted, unsigned long long started)
+	{
+#if FSM_INSTRUMENTATION
+		TransitionMetrics::local().recordEvent(from, nEvent, this->stateIndex, accepted, started);
+#endif
+	}
+
+	//Reports a diagnostic to the sink, if there is one
+	//Parametres:
+		//(code) enumeration of the diagnostic
+		//(first) first value of the diagnostic
+		//(second) second value of the diagnostic
+	void report(diagnostic code, long long first = 0, long long second = 0)
+	{
+#if FSM_DIAGNOSTICS
+		if (this->diagnostics) this->diagnostics->write({ code, first, second });
+#endif
+	}
+};
+
+//Base class for events that states have
+//Used in combination with State to form a Drydock operating state
+class Transition
+{
+public:
+	virtual bool transferEnergy(int energy) { std::cout << "ERROR: event invalid" << std::endl; return false; }
+	virtual bool makeSelection(int option) { std::cout << "ERROR: event invalid" << std::endl; return false; }
+	virtual bool supplyComponents(int components) { std::cout << "ERROR: event invalid" << std::endl; return false; }
+	virtual bool launch(void) { std::cout << "ERROR: event invalid" << std::endl; return false; }
+};
+
+//Tagged event as replayed by batch drivers and benchmarks
+	//(kind) enumeration of the Transition method the event stands for
+	//(payload) integer argument of the Transition method (unused by launch)
+struct DrydockEvent
+{
+	event kind;
+	int payload;
+};
+
+//Outcome of a batch of events
+	//(results) per-event eventResult code, in event order
+	//(finalState) operating state after the batch
+	//(components) Components parametre after the batch
+	//(energy) Energy parametre after the batch
+struct DrydockBatchResult
+{
+	std::vector<unsigned char> results;
+	state finalState = Out_Of_Components;
+	unsigned components = 0;
+	unsigned energy = 0;
+};
+
+//Sequence of builds chosen by Drydock::planBuilds
+	//(options) option codes to select and launch, in demand order
+	//(componentsUsed) components the plan consumes
+	//(energyUsed) energy the plan consumes
+struct BuildPlan
+{
+	std::vector<int> options;
+	unsigned componentsUsed = 0;
+	unsigned long long energyUsed = 0;
+};
+
+//Allocation counters of the ComponentPool for the calling thread
+	//(heapAllocations) blocks taken from the global heap
+	//(pooledAllocations) blocks reused from the pool
+	//(heapReleases) blocks returned to the global heap
+	//(pooledReleases) blocks kept in the pool for reuse
+struct ComponentPoolStats
+{
+	unsigned long long heapAllocations = 0;
+	unsigned long long pooledAllocations = 0;
+	unsigned long long heapReleases = 0;
+	unsigned long long pooledReleases = 0;
+};
+
+//Per-thread free-list pool backing Ship and Weapon allocations
+//Released blocks are kept in a free list per 16-byte size class instead of going back to the global heap,
+//so assembling and scrapping ships stops touching the global allocator once the pool is warm
+//A block released on another thread than it was allocated on simply joins that thread's pool
+class ComponentPool
+{
+private:
+	static const size_t granularity = 16;
+	static const size_t classCount = 8; //pooled sizes up to 128 bytes; larger objects use the global heap
+
+	struct FreeBlock { FreeBlock* next; };
+
+	struct ThreadPool
+	{
+		FreeBlock* freeLists[classCount] = {};
+		bool enabled = true;
+		ComponentPoolStats stats;
+
+		~ThreadPool(void)
+		{
+			for (size_t i = 0; i < classCount; i++)
+			{
+				while (this->freeLists[i])
+				{
+					FreeBlock* block = this->freeLists[i];
+					this->freeLists[i] = block->next;
+					::operator delete(block);
+				}
+			}
+		}
+	};
+
+	ComponentPool() {}; //prevents class from being constructed
+
+	static ThreadPool& local(void)
+	{
+		thread_local ThreadPool pool;
+		return pool;
+	}
+
+	//Returns the size class of an object size, or classCount if it is too large to pool
+	static size_t sizeClass(size_t size) { return size == 0 ? 0 : (size - 1) / granularity; }
+public:
+	//Returns a block of at least (size) bytes, reusing a pooled block if pooling is enabled and one is free
+	//Parametres:
+		//(size) size of the object in bytes
+	static void* allocate(size_t size)
+	{
+		ThreadPool& pool = local();
+		size_t index = sizeClass(size);
+		if (pool.enabled && index < classCount && pool.freeLists[index])
+		{
+			FreeBlock* block = pool.freeLists[index];
+			pool.freeLists[index] = block->next;
+			pool.stats.pooledAllocations++;
+			return block;
+		}
+		pool.stats.heapAllocations++;
+		return ::operator new(index < classCount ? (index + 1) * granularity : size);
+	}
+
+	//Returns a block to the pool (or to the global heap if pooling is disabled or the block is too large)
+	//Parametres:
+		//(block) block returned by allocate()
+		//(size) size of the object in bytes
+	static void release(void* block, size_t size)
+	{
+		if (!block) return;
+		ThreadPool& pool = local();
+		size_t index = sizeClass(size);
+		if (pool.enabled && index < classCount)
+		{
+			FreeBlock* freed = static_cast<FreeBlock*>(block);
+			freed->next = pool.freeLists[index];
+			pool.freeLists[index] = freed;
+			pool.stats.pooledReleases++;
+			return;
+		}
+		pool.stats.heapReleases++;
+		::operator delete(block);
+	}
+
+	//Enables or disables keeping released blocks for reuse on the calling thread
+	//Parametres:
+		//(enabled) whether released blocks are pooled
+	static void setEnabled(bool enabled) { local().enabled = enabled; }
+
+	//Returns the allocation counters of the calling thread
+	static ComponentPoolStats getStats(void) { return local().stats; }
+
+	//Resets the allocation counters of the calling thread
+	static void resetStats(void) { local().stats = ComponentPoolStats(); }
+};
+
+//Base class for objects being handled by the Drydock
+//Inherited by Ship and Weapon subclasses
+class Component
+{
+protected:
+	std::string itemName = "";
+	unsigned itemCost = 10000;
+	Component(void) {};
+public:
+	virtual ~Component(void) {}
+
+	//Ship and Weapon objects are allocated from the ComponentPool
+	static void* operator new(size_t size) { return ComponentPool::allocate(size); }
+	static void operator delete(void* block, size_t size) { ComponentPool::release(block, size); }
+
+	virtual std::string getName(void) { return this->itemName; }
+	virtual unsigned getCost(void) { return this->itemCost; }
+};
+
+//Base class for a Drydock operating state
+//Inherited by specific state classes
+class DrydockState : public State, public Transition
+{
+public:
+	DrydockState(StateContext* context) : State(context) {}
+};
+#pragma endregion
+
+#pragma region Weapon classes
+/*
+	Object-orientated representation of ship weapons
+	The Weapon class is the basis for all ship weapons, which contain two unsigned values for their effectiveness against ship hulls and shields
+	Possible Weapon subclasses:
+		Type VI Phaser Bank - option code 128
+		Type VII Phaser Bank - option code 256
+		Type VIII Phaser Array - option code 512
+		Type IX Phaser Array - option code 1024
+		Type X Phaser Array - option code 2048
+		Type XI Phaser Array - option code 4096
+		Type XII Phaser Array - option code 8192
+*/
+class Weapon : public Component
+{
+protected:
+	unsigned powerAgainstHull = 0;
+	unsigned powerAgainstShields = 0;
+	Weapon(void) {}
+private:
+	unsigned getPowerAgainstHull(void) { return this->powerAgainstHull; }
+	unsigned getPowerAgainstShields(void) { return this->powerAgainstShields; }
+};
+
+class PhaserBankVI : public Weapon
+{
+public:
+	PhaserBankVI(void)
+	{
+		this->itemName = "Type VI Phaser Bank";
+		this->itemCost = 500;
+		this->powerAgainstHull = 10;
+		this->powerAgainstShields = 30;
+	}
+};
+
+class PhaserBankVII : public Weapon
+{
+public:
+	PhaserBankVII(void)
+	{
+		this->itemName = "Type VII Phaser Bank";
+		this->itemCost = 550;
+		this->powerAgainstHull = 20;
+		this->powerAgainstShields = 60;
+	}
+};
+
+class PhaserArrayVIII : public Weapon
+{
+public:
+	PhaserArrayVIII(void)
+	{
+		this->itemName = "Type VIII Phaser Array";
+		this->itemCost = 600;
+		this->powerAgainstHull = 40;
+		this->powerAgainstShields = 120;
+	}
+};
+
+class PhaserArrayIX : public Weapon
+{
+public:
+	PhaserArrayIX(void)
+	{
+		this->itemName = "Type IX Phaser Array";
+		this->itemCost = 700;
+		this->powerAgainstHull = 80;
+		this->powerAgainstShields = 240;
+	}
+};
+
+class PhaserArrayX : public Weapon
+{
+public:
+	PhaserArrayX(void)
+	{
+		this->itemName = "Type X Phaser Array";
+		this->itemCost = 800;
+		this->powerAgainstHull = 160;
+		this->powerAgainstShields = 480;
+	}
+};
+
+class PhaserArrayXI : public Weapon
+{
+public:
+	PhaserArrayXI(void)
+	{
+		this->itemName = "Type XI Phaser Array";
+		this->itemCost = 900;
+		this->powerAgainstHull = 320;
+		this->powerAgainstShields = 960;
+	}
+};
+
+class PhaserArrayXII : public Weapon
+{
+public:
+	PhaserArrayXII(void)
+	{
+		this->itemName = "Type XII Phaser Array";
+		this->itemCost = 1000;
+		this->powerAgainstHull = 640;
+		this->powerAgainstShields = 1920;
+	}
+};
+#pragma endregion
+
+#pragma region Ship classes
+/*
+	Object-orientated representation of ships
+	The Ship class is the basis for all ships, and are composite classes that contain in a weapon inside
+	Possible Ship subclasses:
+		Saber-class scout - option code 1
+		Norway-class science vessel - option code 2
+		Steamrunner-class frigate - option code 4
+		Akira-class carrier - option code 8
+		Prometheus-class cruiser - option code 16
+		Sovereign-class heavy cruiser - option code 32
+		Excalibur-class battelship - option code 64
+*/
+class Ship : public Component
+{
+protected:
+	Weapon * mainWeapon = nullptr;
+	Ship(void) {};
+public:
+	virtual ~Ship(void) { delete this->mainWeapon; }
+	std::string getName(void)
+	{
+		std::string name = this->itemName;
+		if (mainWeapon) name += " + " + this->mainWeapon->getName();
+		return name;
+	}
+	unsigned getCost(void)
+	{
+		unsigned cost = this->itemCost;
+		if (mainWeapon) cost += this->mainWeapon->getCost();
+		return cost;
+	}
+	void addWeapon(Weapon* nWeapon)
+	{
+		if (!nWeapon)
+		{
+			std::cout << "ERROR: cannot accept null Weapon poitner" << std::endl;
+			return;
+		}
+		this->mainWeapon = nWeapon;
+	}
+	Weapon* getWeapon(void) { return this->mainWeapon; }
+};
+
+class Saber : public Ship
+{
+public:
+	Saber(void)
+	{
+		this->itemName = "Saber-class scout";
+		this->itemCost += 1000;
+	}
+};
+
+class Norway : public Ship
+{
+public:
+	Norway(void)
+	{
+		this->itemName = "Norway-class science vessel";
+		this->itemCost += 1250;
+	}
+};
+
+class Steamrunner : public Ship
+{
+public:
+	Steamrunner(void)
+	{
+		this->itemName = "Steamrunner-class frigate";
+		this->itemCost += 1500;
+	}
+};
+
+class Akira : public Ship
+{
+public:
+	Akira(void)
+	{
+		this->itemName = "Akira-class carrier";
+		this->itemCost += 1750;
+	}
+};
+
+class Prometheus : public Ship
+{
+public:
+	Prometheus(void)
+	{
+		this->itemName = "Prometheus-class cruiser";
+		this->itemCost += 2000;
+	}
+};
+
+class Sovereign : public Ship
+{
+public:
+	Sovereign(void)
+	{
+		this->itemName = "Sovereign-class heavy cruiser";
+		this->itemCost += 2500;
+	}
+};
+
+class Excalibur : public Ship
+{
+public:
+	Excalibur(void)
+	{
+		this->itemName = "Excalibur-class battleship";
+		this->itemCost += 3000;
+	}
+};
+
+//Owning handle to an undocked ship; releasing it returns the Ship and its Weapon to the ComponentPool
+typedef std::unique_ptr<Ship> ShipHandle;
+#pragma endregion
+
+#pragma region Ship catalog
+//Constructs a Ship or Weapon subclass for the catalog
+template<class T> Component* makeComponent(void) { return new T; }
+
+//Static description of a Ship or Weapon subclass
+	//(code) option code selecting the subclass
+	//(name) item name set by the subclass
+	//(cost) energy cost of the subclass (Ship costs include the 10000 base cost)
+	//(powerAgainstHull) weapon effectiveness against ship hulls (0 for ships)
+	//(powerAgainstShields) weapon effectiveness against ship shields (0 for ships)
+	//(make) constructs the subclass
+struct CatalogEntry
+{
+	int code;
+	const char* name;
+	unsigned cost;
+	unsigned powerAgainstHull;
+	unsigned powerAgainstShields;
+	Component* (*make)(void);
+};
+
+//Ship subclasses, indexed by the bit position of their option code
+//New subclasses are added here (and to weaponCatalog); the option lookup table is generated from both catalogs
+inline constexpr CatalogEntry shipCatalog[] = {
+	{ 1, "Saber-class scout", 11000, 0, 0, makeComponent<Saber> },
+	{ 2, "Norway-class science vessel", 11250, 0, 0, makeComponent<Norway> },
+	{ 4, "Steamrunner-class frigate", 11500, 0, 0, makeComponent<Steamrunner> },
+	{ 8, "Akira-class carrier", 11750, 0, 0, makeComponent<Akira> },
+	{ 16, "Prometheus-class cruiser", 12000, 0, 0, makeComponent<Prometheus> },
+	{ 32, "Sovereign-class heavy cruiser", 12500, 0, 0, makeComponent<Sovereign> },
+	{ 64, "Excalibur-class battleship", 13000, 0, 0, makeComponent<Excalibur> } };
+
+//Weapon subclasses, indexed by the bit position of their option code above the ship codes
+inline constexpr CatalogEntry weaponCatalog[] = {
+	{ 128, "Type VI Phaser Bank", 500, 10, 30, makeComponent<PhaserBankVI> },
+	{ 256, "Type VII Phaser Bank", 550, 20, 60, makeComponent<PhaserBankVII> },
+	{ 512, "Type VIII Phaser Array", 600, 40, 120, makeComponent<PhaserArrayVIII> },
+	{ 1024, "Type IX Phaser Array", 700, 80, 240, makeComponent<PhaserArrayIX> },
+	{ 2048, "Type X Phaser Array", 800, 160, 480, makeComponent<PhaserArrayX> },
+	{ 4096, "Type XI Phaser Array", 900, 320, 960, makeComponent<PhaserArrayXI> },
+	{ 8192, "Type XII Phaser Array", 1000, 640, 1920, makeComponent<PhaserArrayXII> } };
+
+inline constexpr int shipCount = int(sizeof(shipCatalog) / sizeof(shipCatalog[0]));
+inline constexpr int weaponCount = int(sizeof(weaponCatalog) / sizeof(weaponCatalog[0]));
+static_assert(shipCount <= 8 && weaponCount <= 8, "option codes are limited to 8 ship and 8 weapon bits");
+
+//Checks that every catalog code is the single bit its position implies
+constexpr bool catalogCodesValid(void)
+{
+	for (int i = 0; i < shipCount; i++) if (shipCatalog[i].code != 1 << i) return false;
+	for (int i = 0; i < weaponCount; i++) if (weaponCatalog[i].code != 1 << (shipCount + i)) return false;
+	return true;
+}
+static_assert(catalogCodesValid(), "catalog option codes must be consecutive bits, ships first");
+
+//Cost and component requirement of a decoded option code
+	//(valid) whether both the ship and weapon codes are valid
+	//(cost) total energy cost of the configuration
+	//(componentsNeeded) components consumed by the configuration
+	//(shipIndex) index into shipCatalog, or -1 if the ship code is invalid
+	//(weaponIndex) index into weaponCatalog, or -1 if there is no valid weapon code
+struct OptionCost
+{
+	bool valid;
+	unsigned cost;
+	unsigned componentsNeeded;
+	int shipIndex;
+	int weaponIndex;
+};
+
+//Option lookup tables generated from the catalogs at compile time
+	//(bitPositions) bit position of each 8-bit value with exactly one bit set, -1 otherwise
+	//(entries) decoded configuration for every ship, indexed by [ship bit][weapon bit + 1] (column 0 is no weapon)
+struct OptionTable
+{
+	signed char bitPositions[256];
+	OptionCost entries[shipCount][weaponCount + 1];
+};
+
+constexpr OptionTable makeOptionTable(void)
+{
+	OptionTable table = {};
+	for (int value = 0; value < 256; value++) table.bitPositions[value] = -1;
+	for (int bit = 0; bit < 8; bit++) table.bitPositions[1 << bit] = (signed char)bit;
+
+	for (int ship = 0; ship < shipCount; ship++)
+	{
+		for (int weapon = -1; weapon < weaponCount; weapon++)
+		{
+			OptionCost& entry = table.entries[ship][weapon + 1];
+			entry.valid = true;
+			entry.cost = shipCatalog[ship].cost + (weapon >= 0 ? weaponCatalog[weapon].cost : 0);
+			entry.componentsNeeded = weapon >= 0 ? 2 : 1;
+			entry.shipIndex = ship;
+			entry.weaponIndex = weapon;
+		}
+	}
+	return table;
+}
+
+inline constexpr OptionTable optionTable = makeOptionTable();
+
+//Decodes an option code into its catalog configuration with table lookups, without constructing any objects
+//Codes of (1 << shipCount) and above carry a weapon code (fixing the old behaviour of treating exactly 128 as a ship code)
+//Parametres:
+	//(option) selection value to indicate the ship configuration desired
+constexpr OptionCost decodeOption(int option)
+{
+	OptionCost invalid = { false, 0, 0, -1, -1 };
+	if (option <= 0) return invalid;
+
+	int weaponBits = option >> shipCount;
+	int weapon = -1;
+	if (weaponBits != 0)
+	{
+		weapon = weaponBits < 256 ? optionTable.bitPositions[weaponBits] : -1;
+		if (weapon < 0 || weapon >= weaponCount) return invalid;
+	}
+
+	int ship = optionTable.bitPositions[option & ((1 << shipCount) - 1)];
+	if (ship < 0)
+	{
+		invalid.weaponIndex = weapon;
+		return invalid;
+	}
+	return optionTable.entries[ship][weapon + 1];
+}
+static_assert(decodeOption(1 + 128).cost == 11500 && !decodeOption(128).valid && !decodeOption(3).valid, "option lookup table mismatch");
+
+//Compact value description of a built ship
+//Trivially copyable, so launched ships can be kept in flat arrays instead of as Component/Ship/Weapon objects;
+//cost and weapon power are precomputed and the name is only formatted on demand from its interned id
+	//(option) option code of the configuration
+	//(nameId) interned name, (shipIndex + 1) * 8 + (weaponIndex + 1); 0 for an invalid configuration
+	//(cost) total energy cost
+	//(powerAgainstHull) weapon effectiveness against ship hulls
+	//(powerAgainstShields) weapon effectiveness against ship shields
+struct ShipConfig
+{
+	unsigned short option;
+	unsigned short nameId;
+	unsigned cost;
+	unsigned short powerAgainstHull;
+	unsigned short powerAgainstShields;
+
+	//Builds the configuration an option code selects (invalid if the code is)
+	//Parametres:
+		//(code) selection value to indicate the ship configuration desired
+	static constexpr ShipConfig fromOption(int code)
+	{
+		OptionCost selection = decodeOption(code);
+		if (!selection.valid) return { 0, 0, 0, 0, 0 };
+		const CatalogEntry* weapon = selection.weaponIndex >= 0 ? &weaponCatalog[selection.weaponIndex] : nullptr;
+		return { (unsigned short)code, (unsigned short)((selection.shipIndex + 1) * 8 + selection.weaponIndex + 1), selection.cost,
+			(unsigned short)(weapon ? weapon->powerAgainstHull : 0), (unsigned short)(weapon ? weapon->powerAgainstShields : 0) };
+	}
+
+	bool isValid(void) const { return this->nameId != 0; }
+	bool hasWeapon(void) const { return this->nameId % 8 != 0; }
+	unsigned getCost(void) const { return this->cost; }
+	unsigned getComponentsNeeded(void) const { return this->hasWeapon() ? 2 : 1; }
+
+	//Formats the configuration's name the same way Ship::getName does (empty if invalid)
+	std::string getName(void) const
+	{
+		if (!this->isValid()) return "";
+		std::string name = shipCatalog[this->nameId / 8 - 1].name;
+		if (this->hasWeapon()) name += std::string(" + ") + weaponCatalog[this->nameId % 8 - 1].name;
+		return name;
+	}
+};
+static_assert(std::is_trivially_copyable<ShipConfig>::value && sizeof(ShipConfig) == 12, "ShipConfig must stay a compact value type");
+#pragma endregion
+
+#pragma region Event journal
+//Fixed-size journal record: one event applied to a Drydock and the operating values it left behind
+struct JournalRecord
+{
+	long long timestamp; //system clock, nanoseconds since the epoch
+	int payload;
+	unsigned components;
+	unsigned energy;
+	unsigned char kind; //event enumeration, or journalKind
+	unsigned char result; //eventResult enumeration
+	unsigned char stateIndex;
+	unsigned char reserved;
+};
+static_assert(std::is_trivially_copyable<JournalRecord>::value && sizeof(JournalRecord) == 24, "JournalRecord must stay a fixed-size record");
+
+//Journal file header, followed by (records) JournalRecords
+struct JournalHeader
+{
+	char magic[8];
+	unsigned recordSize;
+	unsigned version;
+	unsigned long long records; //records appended so far, updated with every append
+	unsigned long long reserved;
+};
+
+//Compact binary snapshot of a Drydock's operating state after a number of journal records
+//A zeroed snapshot is a newly constructed Drydock
+struct DrydockSnapshot
+{
+	unsigned long long journalRecords; //journal records the snapshot covers
+	int launchingOption; //option code of the ship being assembled or launched, 0 if there is none
+	unsigned components;
+	unsigned energy;
+	unsigned char stateIndex;
+	unsigned char shipLaunching;
+	unsigned char shipUnderway;
+	unsigned char reserved;
+
+	//Advances the snapshot over the journal records that follow it
+	//Each record carries the state, Components and Energy its event left behind, so replay takes those from the last
+	//record and only tracks the pending ship and flags, instead of running the events through the states again
+	//Parametres:
+		//(records) pointer to the first record after the snapshot
+		//(count) number of records
+	void replay(const JournalRecord* records, size_t count)
+	{
+		if (count == 0) return;
+		for (size_t i = 0; i < count; i++)
+		{
+			const JournalRecord& record = records[i];
+			if (record.result != Event_Accepted) continue;
+			switch (record.kind)
+			{
+			case Make_Selection:
+				this->launchingOption = record.payload;
+				this->shipLaunching = 0; //a launched ship that was not undocked is scrapped
+				break;
+			case Launch_Ship: this->shipLaunching = 1; break;
+			case Undock_Ship:
+				this->launchingOption = 0;
+				this->shipLaunching = 0;
+				this->shipUnderway = 1;
+				break;
+			}
+		}
+		const JournalRecord& last = records[count - 1];
+		this->stateIndex = last.stateIndex;
+		this->components = last.components;
+		this->energy = last.energy;
+		this->journalRecords += count;
+	}
+
+	//Reads the latest complete snapshot of a snapshot file, leaving (output) unchanged if there is none
+	//Parametres:
+		//(path) snapshot file
+		//(output) snapshot to fill in
+	static bool loadLatest(const std::string& path, DrydockSnapshot& output)
+	{
+		std::ifstream input(path, std::ios::binary | std::ios::ate);
+		std::streamoff size = input ? std::streamoff(input.tellg()) : 0;
+		if (size < std::streamoff(sizeof(DrydockSnapshot))) return false;
+		input.seekg(size / sizeof(DrydockSnapshot) * sizeof(DrydockSnapshot) - sizeof(DrydockSnapshot));
+		return bool(input.read((char*)&output, sizeof(output)));
+	}
+};
+static_assert(std::is_trivially_copyable<DrydockSnapshot>::value && sizeof(DrydockSnapshot) == 24, "DrydockSnapshot must stay a fixed-size record");
+
+//Binary append-only log of the events applied to a Drydock, written through a memory-mapped file
+//Appending is a store into the mapping; write-back of the dirty pages is started every (syncInterval) records, and
+//flush() and close() wait for everything appended to reach the disk
+//Records survive a crash of the process as soon as they are appended; a crash of the machine can lose the unflushed tail
+//Reopening an existing journal continues after its last record
+class DrydockJournal
+{
+private:
+	intptr_t file = -1; //file descriptor, or the Windows file handle (INVALID_HANDLE_VALUE is also -1)
+	void* mapping = nullptr; //Windows file mapping handle
+	unsigned char* view = nullptr;
+	JournalHeader* header = nullptr;
+	JournalRecord* records = nullptr;
+	unsigned long long capacity = 0; //records the mapping can hold
+	unsigned long long count = 0;
+	unsigned long long syncedCount = 0; //records whose write-back has been started
+	unsigned long long durableCount = 0; //records known to be on disk
+	unsigned syncInterval;
+	std::string snapshotPath;
+	unsigned long long snapshotInterval = 0; //records between snapshots, 0 when snapshots are off
+	unsigned long long lastSnapshot = 0; //record count when the last snapshot was written
+
+	//Platform file handling (see Event journal)
+	static size_t pageSize(void);
+
+	static unsigned long long fileSize(unsigned long long records) { return sizeof(JournalHeader) + records * sizeof(JournalRecord); }
+
+	//Maps the file with room for (newCapacity) records, extending the file if needed
+	//Parametres:
+		//(newCapacity) number of records the mapping must hold
+	bool map(unsigned long long newCapacity);
+
+	void unmap(void);
+
+	//Remaps the journal with twice the capacity; returns false if the journal is closed or cannot grow
+	bool grow(void)
+	{
+		if (!this->view) return false;
+		unsigned long long newCapacity = this->capacity * 2;
+		this->unmap();
+		return this->map(newCapacity);
+	}
+public:
+	//Opens (or creates) a journal file
+	//Parametres:
+		//(path) journal file
+		//(syncInterval) number of records between flushes to disk
+		//(initialCapacity) number of records to map up front; the mapping doubles when it fills
+	DrydockJournal(const std::string& path, unsigned syncInterval = 65536, unsigned long long initialCapacity = 65536);
+
+	~DrydockJournal(void) { this->close(); }
+
+	DrydockJournal(const DrydockJournal&) = delete;
+	DrydockJournal& operator=(const DrydockJournal&) = delete;
+
+	//Appends a record for an event that has just been applied
+	//Parametres:
+		//(kind) enumeration of the event (or journalKind)
+		//(payload) integer argument of the event
+		//(accepted) whether the Drydock accepted the event
+		//(stateIndex) operating state after the event
+		//(components) Components after the event
+		//(energy) Energy after the event
+	void append(unsigned kind, int payload, bool accepted, unsigned stateIndex, unsigned components, unsigned energy)
+	{
+		if (this->count == this->capacity && !this->grow()) return;
+
+		JournalRecord& record = this->records[this->count];
+		record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		record.payload = payload;
+		record.components = components;
+		record.energy = energy;
+		record.kind = (unsigned char)kind;
+		record.result = accepted ? Event_Accepted : Event_Rejected;
+		record.stateIndex = (unsigned char)stateIndex;
+		record.reserved = 0;
+		this->header->records = ++this->count;
+
+		if (this->count - this->syncedCount >= this->syncInterval) this->sync(false);
+	}
+
+	//Writes the records appended since the last sync, and the header, back to the file
+	//Parametres:
+		//(wait) whether to wait until the data is on disk, or only start the write-back
+	void sync(bool wait);
+
+	//Writes every appended record through to disk and waits for it to get there
+	void flush(void) { this->sync(true); }
+
+	//Flushes the journal, trims the file to the records written and closes it
+	void close(void);
+
+	//Returns whether the journal file is open and mapped
+	bool isOpen(void) { return this->view != nullptr; }
+
+	//Returns the number of records in the journal
+	unsigned long long getCount(void) { return this->count; }
+
+	//Reads the complete records of a journal file
+	//Parametres:
+		//(path) journal file
+		//(output) vector the records are appended to
+		//(first) index of the first record to read
+	static bool load(const std::string& path, std::vector<JournalRecord>& output, unsigned long long first = 0)
+	{
+		std::ifstream input(path, std::ios::binary);
+		JournalHeader fileHeader;
+		if (!input.read((char*)&fileHeader, sizeof(fileHeader))) return false;
+		if (memcmp(fileHeader.magic, "DRYDOCKJ", 8) != 0 || fileHeader.recordSize != sizeof(JournalRecord)) return false;
+		if (first >= fileHeader.records) return true;
+
+		size_t start = output.size();
+		unsigned long long wanted = fileHeader.records - first;
+		output.resize(start + size_t(wanted));
+		input.seekg(std::streamoff(fileSize(first)));
+		input.read((char*)(output.data() + start), std::streamsize(wanted * sizeof(JournalRecord)));
+		output.resize(start + size_t(input.gcount()) / sizeof(JournalRecord)); //drop records missing from a truncated file
+		return true;
+	}
+
+	//Appends every (interval) records a snapshot of the journalled Drydock to a snapshot file, so recovery only
+	//replays the records written after the latest snapshot
+	//Parametres:
+		//(path) snapshot file
+		//(interval) number of records between snapshots, or 0 to stop writing snapshots
+	void setSnapshots(const std::string& path, unsigned long long interval)
+	{
+		this->snapshotPath = path;
+		this->snapshotInterval = interval;
+		this->lastSnapshot = this->count;
+	}
+
+	//Returns whether enough records have been appended since the last snapshot for another to be written
+	bool isSnapshotDue(void) { return this->snapshotInterval && this->count - this->lastSnapshot >= this->snapshotInterval; }
+
+	//Flushes the journal and appends a snapshot covering every record written so far to the snapshot file
+	//The journal is flushed first so a snapshot never refers to records that are not on disk
+	//Parametres:
+		//(nSnapshot) operating state of the Drydock after the last appended record
+	void writeSnapshot(DrydockSnapshot nSnapshot)
+	{
+		this->lastSnapshot = this->count;
+		if (this->snapshotPath.empty()) return;
+		this->flush();
+		nSnapshot.journalRecords = this->count;
+		std::ofstream output(this->snapshotPath, std::ios::binary | std::ios::app);
+		output.write((const char*)&nSnapshot, sizeof(nSnapshot));
+	}
+};
+#pragma endregion
+
+#pragma region State classes
+//State for when Drydock is out of components
+class OutOfComponents : public DrydockState
+{
+public:
+	OutOfComponents(StateContext* context) : DrydockState(context) {}
+	bool transferEnergy(int energy);
+	bool makeSelection(int option);
+	bool supplyComponents(int components);
+	bool launch(void);
+};
+
+//State for when Drydock is out of energy
+class NoEnergy : public DrydockState
+{
+public:
+	NoEnergy(StateContext* context) : DrydockState(context) {}
+	bool transferEnergy(int energy);
+	bool makeSelection(int option);
+	bool supplyComponents(int components);
+	bool launch(void);
+};
+
+//State for when Drydock has energy
+class HasEnergy : public DrydockState
+{
+public:
+	HasEnergy(StateContext* context) : DrydockState(context) {}
+	bool transferEnergy(int energy);
+	bool makeSelection(int option);
+	bool supplyComponents(int components);
+	bool launch(void);
+};
+
+//State for when Drydock is launching a ship
+class LaunchingShip : public DrydockState
+{
+public:
+	LaunchingShip(StateContext* context) : DrydockState(context) {}
+	bool transferEnergy(int energy);
+	bool makeSelection(int option);
+	bool supplyComponents(int components);
+	bool launch(void);
+};
+#pragma endregion
+
+//Actual Drydock state machine driver
+class Drydock : public StateContext, public Transition
+{
+	friend class HasEnergy;
+	friend class LaunchingShip;
+protected:
+	Ship * launchingShip = nullptr;
+	ShipConfig launchingConfig = { 0, 0, 0, 0, 0 }; //value description of launchingShip
+	bool shipLaunching = false;
+	bool shipUnderway = false;
+	DrydockJournal* journal = nullptr;
+
+	//Records an applied event in the journal, if there is one, and writes a snapshot when one is due
+	//Parametres:
+		//(kind) enumeration of the event (or journalKind)
+		//(payload) integer argument of the event
+		//(accepted) whether the event was accepted
+	void journalEvent(unsigned kind, int payload, bool accepted)
+	{
+		if (!this->journal) return;
+		this->journal->append(kind, payload, accepted, this->stateIndex, this->parametres[Components], this->parametres[Energy]);
+		if (this->journal->isSnapshotDue()) this->journal->writeSnapshot(this->snapshot());
+	}
+
+	//Handles an event for one transition table entry, returning whether the event was accepted
+	//Parametres:
+		//(dock) Drydock the event is applied to
+		//(payload) integer argument of the event (unused by launch)
+		//(next) state to enter afterwards; preset from the table entry, may be overridden by the handler
+	typedef bool(*TransitionHandler)(Drydock* dock, int payload, state& next);
+
+	//Single cell of the transition table
+	struct TransitionEntry
+	{
+		TransitionHandler handler;
+		state nextState;
+	};
+
+	//Compiled [state x event] transition table mirroring the class-per-state handlers without console output
+	static const TransitionEntry transitionTable[stateCount][eventCount];
+
+	//Looks up and applies the transition table entry for the current state and the given event
+	//The state change is counted like a setState() call, but the State hooks do not fire (the Drydock states define none)
+	//Parametres:
+		//(nEvent) enumeration of the event to apply; kinds outside the event enumeration are rejected
+		//(payload) integer argument of the event
+	bool dispatch(event nEvent, int payload)
+	{
+		if (unsigned(nEvent) >= unsigned(eventCount)) return false;
+		unsigned from = this->stateIndex;
+		unsigned long long started = this->beginEvent();
+		const TransitionEntry& entry = transitionTable[from][nEvent];
+		state next = entry.nextState;
+		bool accepted = entry.handler(this, payload, next);
+		this->stateIndex = next;
+		this->currentState = this->availableStates[next];
+		this->countTransition(from, next);
+		this->endEvent(from, nEvent, accepted, started);
+		return accepted;
+	}
+
+	//Transition table handlers (see Transition table engine)
+	static bool reject(Drydock* dock, int payload, state& next);
+	static bool supply(Drydock* dock, int payload, state& next);
+	static bool transfer(Drydock* dock, int payload, state& next);
+	static bool select(Drydock* dock, int payload, state& next);
+	static bool launchShip(Drydock* dock, int payload, state& next);
+	static Ship* assemble(const OptionCost& selection);
+public:
+	Drydock(void)
+	{
+		//initialise Drydock's operating states (parametres start at 0)
+		this->availableStates[Out_Of_Components] = new OutOfComponents(this);
+		this->availableStates[No_Energy] = new NoEnergy(this);
+		this->availableStates[Has_Energy] = new HasEnergy(this);
+		this->availableStates[Launching_Ship] = new LaunchingShip(this);
+
+									   //set starting state
+		this->setState(Out_Of_Components);
+	}
+
+	~Drydock(void)
+	{
+		//release memory held by a ship that has not been undocked (undockShip() hands ownership over)
+		delete this->launchingShip;
+		delete this->journal;
+	}
+
+	//Replaces the journal that records every applied event; Drydock takes ownership of it
+	//Parametres:
+		//(nJournal) new journal, or nullptr to stop journalling
+	void setJournal(DrydockJournal* nJournal)
+	{
+		if (nJournal != this->journal) delete this->journal;
+		this->journal = nJournal;
+	}
+
+	//Returns the current journal (nullptr if events are not journalled)
+	DrydockJournal* getJournal(void) { return this->journal; }
+
+	//Handles user attempting energy transfer with the current operating state
+	//Parametres:
+		//(energy) energy to be transferred to power the Drydock
+	bool transferEnergy(int energy)
+	{
+		unsigned from = this->stateIndex;
+		unsigned long long started = this->beginEvent();
+		DrydockState* cState = (DrydockState*)this->currentState;
+		bool accepted = cState->transferEnergy(energy);
+		this->endEvent(from, Transfer_Energy, accepted, started);
+		this->journalEvent(Transfer_Energy, energy, accepted);
+		return accepted;
+	}
+
+	//Handles user attempting ship/component selection with the current operating state
+	//Parametres:
+		//(option) selection value to indicate the ship configuration desired
+	bool makeSelection(int option)
+	{
+		unsigned from = this->stateIndex;
+		unsigned long long started = this->beginEvent();
+		DrydockState* cState = (DrydockState*)this->currentState;
+		bool accepted = cState->makeSelection(option);
+		this->endEvent(from, Make_Selection, accepted, started);
+		this->journalEvent(Make_Selection, option, accepted);
+		return accepted;
+	}
+
+	//Handles user supplying components with the current operating state
+	//Parametres:
+		//(components) amount of components to supply
+	bool supplyComponents(int components)
+	{
+		unsigned from = this->stateIndex;
+		unsigned long long started = this->beginEvent();
+		DrydockState* cState = (DrydockState*)this->currentState;
+		bool accepted = cState->supplyComponents(components);
+		this->endEvent(from, Supply_Components, accepted, started);
+		this->journalEvent(Supply_Components, components, accepted);
+		return accepted;
+	}
+
+	//Handles user attempting launching ship with the current operating state
+	bool launch(void)
+	{
+		unsigned from = this->stateIndex;
+		unsigned long long started = this->beginEvent();
+		DrydockState* cState = (DrydockState*)this->currentState;
+		bool accepted = cState->launch();
+		this->endEvent(from, Launch_Ship, accepted, started);
+		this->journalEvent(Launch_Ship, 0, accepted);
+		return accepted;
+	}
+
+	//Handles a tagged event by calling the matching Transition method
+	//Parametres:
+		//(nEvent) event to apply
+	bool apply(const DrydockEvent& nEvent)
+	{
+		switch (nEvent.kind)
+		{
+		case Transfer_Energy: return this->transferEnergy(nEvent.payload);
+		case Make_Selection: return this->makeSelection(nEvent.payload);
+		case Supply_Components: return this->supplyComponents(nEvent.payload);
+		case Launch_Ship: return this->launch();
+		}
+		return false;
+	}
+
+	//Applies a contiguous batch of events through the transition table, without per-event virtual dispatch or console output
+	//Semantics and transition counts match driving each event through the Transition methods one at a time; kinds outside
+	//the event enumeration are rejected and left out of the journal
+	//Parametres:
+		//(events) pointer to the first event of the batch
+		//(count) number of events in the batch
+	DrydockBatchResult processEvents(const DrydockEvent* events, unsigned count)
+	{
+		DrydockBatchResult result;
+		result.results.resize(count);
+		for (unsigned i = 0; i < count; i++)
+		{
+			bool accepted = this->dispatch(events[i].kind, events[i].payload);
+			if (unsigned(events[i].kind) < unsigned(eventCount)) this->journalEvent(events[i].kind, events[i].payload, accepted);
+			result.results[i] = accepted ? Event_Accepted : Event_Rejected;
+		}
+
+		result.finalState = state(this->stateIndex);
+		result.components = this->getParamVal(Components);
+		result.energy = this->getParamVal(Energy);
+		return result;
+	}
+
+	//Applies a batch of events held in a vector
+	//Parametres:
+		//(events) events to apply, in order
+	DrydockBatchResult processEvents(const std::vector<DrydockEvent>& events)
+	{
+		return this->processEvents(events.data(), unsigned(events.size()));
+	}
+
+	//Build planning (see Build planner)
+	static BuildPlan planBuilds(unsigned components, unsigned energy, const int* demand, unsigned count);
+	BuildPlan planBuilds(const std::vector<int>& demand);
+	DrydockBatchResult executePlan(const BuildPlan& plan, std::vector<ShipHandle>* ships = nullptr);
+
+	//Returns the name of the ship configuration an option code selects (empty if the code is invalid)
+	//Parametres:
+		//(option) selection value to indicate the ship configuration desired
+	static std::string getOptionName(int option) { return ShipConfig::fromOption(option).getName(); }
+
+	//Returns the value description of the ship being assembled or launched (invalid if there is none)
+	ShipConfig getLaunchingConfig(void) { return this->launchingShip ? this->launchingConfig : ShipConfig{ 0, 0, 0, 0, 0 }; }
+
+	//Returns a snapshot of the Drydock's operating state (its journal position is filled in by DrydockJournal::writeSnapshot())
+	DrydockSnapshot snapshot(void)
+	{
+		DrydockSnapshot nSnapshot = {};
+		nSnapshot.launchingOption = this->launchingShip ? this->launchingConfig.option : 0;
+		nSnapshot.components = this->parametres[Components];
+		nSnapshot.energy = this->parametres[Energy];
+		nSnapshot.stateIndex = (unsigned char)this->stateIndex;
+		nSnapshot.shipLaunching = this->shipLaunching;
+		nSnapshot.shipUnderway = this->shipUnderway;
+		return nSnapshot;
+	}
+
+	//Puts the Drydock into the operating state of a snapshot, reassembling the pending ship from its option code
+	//No diagnostics are reported and nothing is journalled; returns false (leaving the Drydock unchanged) if the snapshot
+	//is corrupt, i.e. its state or option code is out of range
+	//Parametres:
+		//(nSnapshot) snapshot to restore
+	bool restore(const DrydockSnapshot& nSnapshot)
+	{
+		if (nSnapshot.stateIndex >= stateCount) return false;
+		if (nSnapshot.launchingOption && !decodeOption(nSnapshot.launchingOption).valid) return false;
+
+		delete this->launchingShip;
+		this->launchingShip = nullptr;
+		if (nSnapshot.launchingOption)
+		{
+			this->launchingShip = assemble(decodeOption(nSnapshot.launchingOption));
+			this->launchingConfig = ShipConfig::fromOption(nSnapshot.launchingOption);
+		}
+		this->parametres[Components] = nSnapshot.components;
+		this->parametres[Energy] = nSnapshot.energy;
+		this->stateIndex = nSnapshot.stateIndex;
+		this->currentState = this->availableStates[nSnapshot.stateIndex];
+		this->shipLaunching = nSnapshot.shipLaunching != 0;
+		this->shipUnderway = nSnapshot.shipUnderway != 0;
+		return true;
+	}
+
+	//Restores the Drydock from the latest snapshot and replays the journal records written after it
+	//Returns false (leaving the Drydock unchanged) if the journal cannot be read or the recovered state is corrupt
+	//Parametres:
+		//(journalPath) journal file
+		//(snapshotPath) snapshot file; a Drydock with no snapshot is replayed from the start of the journal
+	bool recover(const std::string& journalPath, const std::string& snapshotPath)
+	{
+		DrydockSnapshot nSnapshot = {};
+		DrydockSnapshot::loadLatest(snapshotPath, nSnapshot);
+
+		std::vector<JournalRecord> tail;
+		if (!DrydockJournal::load(journalPath, tail, nSnapshot.journalRecords)) return false;
+		nSnapshot.replay(tail.data(), tail.size());
+		return this->restore(nSnapshot);
+	}
+
+	//Releases the assembled ship from Drydock, handing over ownership of it
+	ShipHandle undockShip(void)
+	{
+		if (this->shipLaunching)
+		{
+			ShipHandle ship(this->launchingShip);
+			this->launchingShip = nullptr;
+			this->shipLaunching = false;
+			this->shipUnderway = true;
+			this->journalEvent(Undock_Ship, 0, true);
+			return ship;
+		}
+		else
+		{
+			this->report(No_Ship_Assembled);
+			this->journalEvent(Undock_Ship, 0, false);
+			return nullptr;
+		}
+		return nullptr; //fallback
+	}
+};
+
+//Drydock driven by the compiled [state x event] transition table
+//Produces the same results as the class-per-state Drydock (which remains the reference implementation),
+//but each event costs one indexed table load and one handler call, and no console output is written
+class TableDrydock : public Drydock
+{
+private:
+	//Applies an event through the transition table and records it in the journal
+	//Parametres:
+		//(nEvent) enumeration of the event to apply
+		//(payload) integer argument of the event
+	bool dispatchJournalled(event nEvent, int payload)
+	{
+		bool accepted = this->dispatch(nEvent, payload);
+		this->journalEvent(nEvent, payload, accepted);
+		return accepted;
+	}
+public:
+	bool transferEnergy(int energy) { return this->dispatchJournalled(Transfer_Energy, energy); }
+	bool makeSelection(int option) { return this->dispatchJournalled(Make_Selection, option); }
+	bool supplyComponents(int components) { return this->dispatchJournalled(Supply_Components, components); }
+	bool launch(void) { return this->dispatchJournalled(Launch_Ship, 0); }
+};
@@ -0,0 +1,258 @@
+#pragma once
+
+/*
+	Discrete-event shipyard simulator
+
+	Notes:
+		Arrival processes for components, energy and orders drive many Drydocks through the hierarchical timer wheel of
+		AsyncDrydock.h (which is defined with or without coroutines)
+		One tick is one simulated second; the Drydocks decide every event, the simulator only decides when events arrive
+*/
+
+#include "FSM.h"
+#include "AsyncDrydock.h"
+#include <cmath>
+
+#pragma region Shipyard simulator
+//Arrival processes of a shipyard simulation; every interval is a mean in ticks, drawn from an exponential distribution
+	//(docks) number of Drydocks
+	//(componentInterval) mean ticks between component deliveries to a Drydock
+	//(componentsMax) components per delivery, drawn uniformly from 1 to this
+	//(energyInterval) mean ticks between energy transfers to a Drydock
+	//(energyMax) energy per transfer, drawn uniformly from 1 to this
+	//(orderInterval) mean ticks between ship orders at a Drydock; orders the Drydock rejects are turned away
+	//(weaponShare) percentage of orders that select a weapon as well as a ship
+	//(buildTicks) ticks from an accepted order to the ship's launch
+	//(seed) seed of the arrival processes
+struct ShipyardProfile
+{
+	unsigned docks = 1000;
+	unsigned componentInterval = 900;
+	unsigned componentsMax = 10;
+	unsigned energyInterval = 120;
+	unsigned energyMax = 8000;
+	unsigned orderInterval = 300;
+	unsigned weaponShare = 50;
+	unsigned buildTicks = 1800;
+	unsigned long long seed = 1;
+};
+
+//Results of a shipyard simulation
+	//(ticks) simulated ticks (seconds)
+	//(events) events applied to the Drydocks
+	//(accepted) events the Drydocks accepted
+	//(launches) ships launched and undocked
+	//(ordersTurnedAway) orders the Drydocks rejected
+	//(energyTransferred) energy the Drydocks accepted
+	//(stateTicks) Drydock-ticks spent in each state
+	//(wallSeconds) wall-clock time taken by the simulation
+struct ShipyardReport
+{
+	unsigned long long ticks = 0;
+	unsigned long long events = 0;
+	unsigned long long accepted = 0;
+	unsigned long long launches = 0;
+	unsigned long long ordersTurnedAway = 0;
+	unsigned long long energyTransferred = 0;
+	unsigned long long stateTicks[stateCount] = {};
+	double wallSeconds = 0;
+
+	//Returns the ships launched per simulated hour across the shipyard
+	double getLaunchesPerHour(void) const { return this->ticks ? this->launches * 3600.0 / this->ticks : 0; }
+
+	//Returns the share of Drydock time spent in a state, from 0 to 1
+	//Parametres:
+		//(nState) state to look up
+	double getStateShare(state nState) const
+	{
+		unsigned long long total = 0;
+		for (int i = 0; i < stateCount; i++) total += this->stateTicks[i];
+		return total ? double(this->stateTicks[nState]) / total : 0;
+	}
+
+	//Returns the events simulated per wall-clock second
+	double getEventsPerSecond(void) const { return this->wallSeconds > 0 ? this->events / this->wallSeconds : 0; }
+};
+
+//Discrete-event simulation of a shipyard of Drydocks (of any class with the Drydock interface, e.g. TableDrydock)
+//Each Drydock has four timers, one per event kind: the component, energy and order arrival processes reschedule
+//themselves every time they fire, and an accepted order schedules the Drydock's launch; a run holds no other state,
+//so it takes the same memory however many events it simulates
+template<class Dock = Drydock> class ShipyardSimulator
+{
+private:
+	static constexpr unsigned exponentialSteps = 1024; //points of the exponential distribution table
+
+	//Drydock and its state accounting, kept together so an event touches as few cache lines as possible
+		//(seen) state the Drydock was last seen in
+		//(since) tick the Drydock entered that state
+	struct Berth
+	{
+		Dock dock;
+		state seen;
+		unsigned long long since;
+	};
+
+	ShipyardProfile profile;
+	Berth* berths;
+	TimerWheel<unsigned> wheel;
+	double exponential[exponentialSteps]; //inverse CDF of the unit exponential distribution at evenly spaced points
+	unsigned long long randomState;
+	ShipyardReport report;
+
+	//Starts loading the cache lines of the Drydock a timer's event will be applied to
+	//Parametres:
+		//(timer) index of the timer; Drydock index * 4 + event
+	void prefetch(unsigned timer)
+	{
+		const char* berth = (const char*)&this->berths[timer / 4];
+		for (size_t offset = 0; offset < sizeof(Berth); offset += 64)
+		{
+#if defined(_MSC_VER) && FSM_X86
+			_mm_prefetch(berth + offset, _MM_HINT_T0);
+#elif !defined(_MSC_VER)
+			__builtin_prefetch(berth + offset);
+#endif
+		}
+	}
+
+	//Returns the next value of the xorshift64* generator behind the arrival processes
+	unsigned long long draw(void)
+	{
+		this->randomState ^= this->randomState >> 12;
+		this->randomState ^= this->randomState << 25;
+		this->randomState ^= this->randomState >> 27;
+		return this->randomState * 0x2545F4914F6CDD1Dull;
+	}
+
+	//Returns an exponentially distributed delay of at least one tick
+	//Parametres:
+		//(mean) mean delay in ticks
+	unsigned long long interval(unsigned mean)
+	{
+		unsigned long long delay = (unsigned long long)(mean * this->exponential[this->draw() >> 54] + 0.5);
+		return delay ? delay : 1;
+	}
+
+	//Returns a uniformly distributed amount from 1 to a maximum
+	//Parametres:
+		//(maximum) largest amount
+	int amount(unsigned maximum) { return int(1 + (((this->draw() >> 32) * maximum) >> 32)); }
+
+	//Returns the option code of a random order
+	int order(void)
+	{
+		unsigned long long value = this->draw();
+		int option = 1 << (((value >> 32) * shipCount) >> 32);
+		if ((((value & 0xFFFF) * 100) >> 16) < this->profile.weaponShare) option |= 1 << (shipCount + ((((value >> 16) & 0xFFFF) * weaponCount) >> 16));
+		return option;
+	}
+
+	//Applies the event of a timer that came due to its Drydock and schedules what follows from it
+	//Parametres:
+		//(timer) index of the timer; Drydock index * 4 + event
+	void fire(unsigned timer)
+	{
+		unsigned index = timer / 4;
+		Berth& berth = this->berths[index];
+		Dock& dock = berth.dock;
+		bool accepted = false;
+		switch (event(timer % 4))
+		{
+		case Supply_Components:
+			accepted = dock.supplyComponents(this->amount(this->profile.componentsMax));
+			this->wheel.schedule(timer, this->interval(this->profile.componentInterval));
+			break;
+		case Transfer_Energy:
+		{
+			int energy = this->amount(this->profile.energyMax);
+			accepted = dock.transferEnergy(energy);
+			if (accepted) this->report.energyTransferred += energy;
+			this->wheel.schedule(timer, this->interval(this->profile.energyInterval));
+			break;
+		}
+		case Make_Selection:
+			accepted = dock.makeSelection(this->order());
+			if (accepted) this->wheel.schedule(index * 4 + Launch_Ship, this->profile.buildTicks);
+			else this->report.ordersTurnedAway++;
+			this->wheel.schedule(timer, this->interval(this->profile.orderInterval));
+			break;
+		case Launch_Ship:
+			accepted = dock.launch();
+			if (accepted && dock.undockShip()) this->report.launches++;
+			break;
+		}
+		this->report.events++;
+		this->report.accepted += accepted;
+
+		//charge the time since the Drydock's last state change to the state it is leaving
+		state current = dock.getState();
+		if (current != berth.seen)
+		{
+			unsigned long long now = this->wheel.getTime();
+			this->report.stateTicks[berth.seen] += now - berth.since;
+			berth.seen = current;
+			berth.since = now;
+		}
+	}
+public:
+	//Parametres:
+		//(nProfile) arrival processes of the shipyard
+	ShipyardSimulator(const ShipyardProfile& nProfile) : profile(nProfile)
+	{
+		this->berths = new Berth[this->profile.docks];
+		this->randomState = this->profile.seed ? this->profile.seed : 1;
+		for (unsigned i = 0; i < exponentialSteps; i++) this->exponential[i] = -log((i + 0.5) / exponentialSteps);
+
+		//start every arrival process a random part of its interval in, so the Drydocks do not move in step
+		for (unsigned i = 0; i < this->profile.docks; i++)
+		{
+			this->berths[i].seen = this->berths[i].dock.getState();
+			this->berths[i].since = 0;
+			this->wheel.schedule(i * 4 + Supply_Components, this->interval(this->profile.componentInterval));
+			this->wheel.schedule(i * 4 + Transfer_Energy, this->interval(this->profile.energyInterval));
+			this->wheel.schedule(i * 4 + Make_Selection, this->interval(this->profile.orderInterval));
+		}
+	}
+
+	~ShipyardSimulator(void)
+	{
+		delete[] this->berths;
+	}
+
+	ShipyardSimulator(const ShipyardSimulator&) = delete;
+	ShipyardSimulator& operator=(const ShipyardSimulator&) = delete;
+
+	//Simulates until an event budget or a simulated time is reached, whichever comes first, and returns the totals so far
+	//The tick that reaches the event budget is finished, so a run may apply a few more events than the budget
+	//Parametres:
+		//(maxEvents) events to apply
+		//(maxTicks) last tick to simulate
+	const ShipyardReport& run(unsigned long long maxEvents, unsigned long long maxTicks = ~0ull)
+	{
+		auto start = std::chrono::steady_clock::now();
+		auto fire = [this](unsigned timer) { this->fire(timer); };
+		auto prefetch = [this](unsigned timer) { this->prefetch(timer); };
+		while (this->report.events < maxEvents && this->wheel.advance(maxTicks, fire, prefetch)) {}
+		this->report.wallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		//charge each Drydock's current state up to the end of the run
+		unsigned long long now = this->wheel.getTime();
+		for (unsigned i = 0; i < this->profile.docks; i++)
+		{
+			this->report.stateTicks[this->berths[i].seen] += now - this->berths[i].since;
+			this->berths[i].since = now;
+		}
+		this->report.ticks = now;
+		return this->report;
+	}
+
+	//Returns a Drydock of the shipyard
+	//Parametres:
+		//(index) index of the Drydock
+	Dock& getDock(unsigned index) { return this->berths[index].dock; }
+
+	//Returns the current simulated tick
+	unsigned long long getTime(void) { return this->wheel.getTime(); }
+};
+#pragma endregion
@@ -0,0 +1,875 @@
+/*
+	Drydock unit tests
+
+	Notes:
+		Built as the fsm_tests target and run by ctest; prints each failed check and exits non-zero if any failed
+		The reference Drydock (class-per-state) defines the expected results for every other engine
+*/
+
+#include "Utility.h"
+#include "FSM.h"
+#include "Diagnostics.h"
+#include "Engines.h"
+#include "AsyncDrydock.h"
+#include "Simulator.h"
+#include <random>
+#include <sstream>
+#include <chrono>
+#include <fcntl.h>
+
+//Records a failed check with its source location
+#define FSM_CHECK(condition) DrydockTests::check((condition), #condition, __FILE__, __LINE__)
+
+class DrydockTests
+{
+private:
+	DrydockTests() {}; //prevents class from being constructed
+
+	static unsigned& failures(void)
+	{
+		static unsigned count = 0;
+		return count;
+	}
+
+	//Builds a random event stream that reaches every state, including option codes that are invalid
+	//Parametres:
+		//(count) number of events
+		//(seed) seed of the random stream
+	static vector<DrydockEvent> randomStream(unsigned count, unsigned seed)
+	{
+		const int options[] = { 1, 2, 4, 8, 16, 32, 64, 1 + 128, 2 + 256, 64 + 8192, 3, 128, 0, -1, 1 + 128 + 256 };
+		mt19937 random(seed);
+		vector<DrydockEvent> stream;
+		stream.reserve(count);
+		for (unsigned i = 0; i < count; i++)
+		{
+			event kind = event(random() % 4);
+			int payload = 0;
+			switch (kind)
+			{
+			case Transfer_Energy: payload = int(random() % 40000) - 1000; break;
+			case Make_Selection: payload = options[random() % (sizeof(options) / sizeof(options[0]))]; break;
+			case Supply_Components: payload = int(random() % 6); break;
+			case Launch_Ship: break;
+			}
+			stream.push_back({ kind, payload });
+		}
+		return stream;
+	}
+
+	//Drives a Drydock implementation through a stream, collecting the accepted flag, state, Components and Energy after each event
+	//Parametres:
+		//(stream) events to apply
+	template<class Dock> static vector<unsigned> trace(const vector<DrydockEvent>& stream)
+	{
+		Dock dock;
+		vector<unsigned> result;
+		result.reserve(stream.size() * 4);
+		for (const DrydockEvent& e : stream)
+		{
+			bool accepted = false;
+			switch (e.kind)
+			{
+			case Transfer_Energy: accepted = dock.transferEnergy(e.payload); break;
+			case Make_Selection: accepted = dock.makeSelection(e.payload); break;
+			case Supply_Components: accepted = dock.supplyComponents(e.payload); break;
+			case Launch_Ship: accepted = dock.launch(); break;
+			}
+			result.push_back(accepted);
+			result.push_back(unsigned(dock.getState()));
+			result.push_back(dock.getParamVal(Components));
+			result.push_back(dock.getParamVal(Energy));
+		}
+		return result;
+	}
+
+	//Checks the reference Drydock's transitions for a scripted build cycle
+	static void testReferenceTransitions(void)
+	{
+		Drydock dock;
+		FSM_CHECK(dock.getState() == Out_Of_Components);
+		FSM_CHECK(!dock.transferEnergy(100));
+		FSM_CHECK(!dock.makeSelection(1));
+		FSM_CHECK(!dock.launch());
+
+		FSM_CHECK(dock.supplyComponents(3));
+		FSM_CHECK(dock.getState() == No_Energy && dock.getParamVal(Components) == 3);
+		FSM_CHECK(!dock.transferEnergy(0));
+		FSM_CHECK(!dock.transferEnergy(-5));
+		unsigned cost = decodeOption(1 + 128).cost;
+		FSM_CHECK(dock.transferEnergy(cost + 1000));
+		FSM_CHECK(dock.getState() == Has_Energy && dock.getParamVal(Energy) == cost + 1000);
+
+		FSM_CHECK(!dock.makeSelection(3)); //two ship codes
+		FSM_CHECK(!dock.makeSelection(128)); //weapon without a ship
+		FSM_CHECK(!dock.makeSelection(64 + 8192)); //not enough energy
+		FSM_CHECK(dock.getState() == Has_Energy);
+
+		FSM_CHECK(dock.makeSelection(1 + 128));
+		FSM_CHECK(dock.getState() == Launching_Ship);
+		FSM_CHECK(dock.getLaunchingConfig().getName() == Drydock::getOptionName(1 + 128));
+		FSM_CHECK(!dock.transferEnergy(5));
+		FSM_CHECK(!dock.supplyComponents(5));
+		FSM_CHECK(dock.launch());
+
+		//launching uses up the ship's components and energy
+		FSM_CHECK(dock.getParamVal(Components) == 3 - 2 && dock.getParamVal(Energy) == 1000);
+		FSM_CHECK(dock.getState() == Has_Energy);
+
+		ShipHandle ship = dock.undockShip();
+		FSM_CHECK(ship != nullptr && ship->getCost() == cost);
+		FSM_CHECK(dock.undockShip() == nullptr);
+
+		//selecting again after a launch scraps the waiting ship, and the new one cannot be undocked before it is launched
+		auto relaunch = [cost](auto& relaunched) {
+			relaunched.supplyComponents(5);
+			relaunched.transferEnergy(2 * cost + 1000);
+			FSM_CHECK(relaunched.makeSelection(1 + 128) && relaunched.launch());
+			FSM_CHECK(relaunched.makeSelection(1 + 128));
+			FSM_CHECK(relaunched.undockShip() == nullptr);
+			FSM_CHECK(relaunched.launch() && relaunched.undockShip() != nullptr);
+		};
+		TableDrydock table;
+		relaunch(dock);
+		relaunch(table);
+		FSM_CHECK(dock.getState() == Has_Energy && table.getState() == Has_Energy);
+
+		//launching without an assembled ship drops the Drydock back to No_Energy
+		FSM_CHECK(!dock.launch());
+		FSM_CHECK(dock.getState() == No_Energy);
+	}
+
+	//Checks that every option code's catalog configuration matches the Ship it assembles
+	static void testCatalog(void)
+	{
+		for (int option = -1; option < 16384; option++)
+		{
+			ShipConfig config = ShipConfig::fromOption(option);
+			OptionCost selection = decodeOption(option);
+			FSM_CHECK(config.isValid() == selection.valid);
+			if (!selection.valid) continue;
+
+			Drydock dock;
+			dock.supplyComponents(2);
+			dock.transferEnergy(2000000000);
+			FSM_CHECK(dock.makeSelection(option));
+			FSM_CHECK(dock.launch());
+			ShipHandle ship = dock.undockShip();
+			FSM_CHECK(ship != nullptr && ship->getName() == config.getName() && ship->getCost() == config.getCost());
+		}
+	}
+
+	//Checks that the transition table, compile-time, batch, fleet and executor engines match the reference Drydock
+	static void testEngineEquivalence(void)
+	{
+		vector<DrydockEvent> stream = randomStream(20000, 1);
+		vector<unsigned> expected = trace<Drydock>(stream);
+		FSM_CHECK(trace<TableDrydock>(stream) == expected);
+		FSM_CHECK(trace<StaticDrydock>(stream) == expected);
+
+		Drydock batch;
+		DrydockBatchResult result = batch.processEvents(stream);
+		bool batchMatches = true;
+		for (size_t i = 0; i < stream.size(); i++) batchMatches &= result.results[i] == expected[i * 4];
+		FSM_CHECK(batchMatches);
+		FSM_CHECK(unsigned(result.finalState) == expected[expected.size() - 3]);
+		FSM_CHECK(result.components == expected[expected.size() - 2] && result.energy == expected[expected.size() - 1]);
+
+		//kinds outside the event enumeration are rejected without touching the Drydock
+		vector<DrydockEvent> invalid = { { event(eventCount), 0 }, { event(255), 1 }, { event(-1), 2 } };
+		result = batch.processEvents(invalid);
+		FSM_CHECK(result.results == vector<unsigned char>(3, Event_Rejected));
+		FSM_CHECK(unsigned(result.finalState) == expected[expected.size() - 3] && result.components == expected[expected.size() - 2]);
+
+		//every fleet machine gets its own stream; broadcasting runs through the scalar and AVX2 kernels
+		const unsigned machines = 37;
+		for (int vectorised = 0; vectorised < 2; vectorised++)
+		{
+			DrydockFleet fleet(machines);
+			fleet.setVectorised(vectorised != 0);
+			vector<vector<DrydockEvent>> streams;
+			for (unsigned m = 0; m < machines; m++) streams.push_back(randomStream(2000, 100 + m));
+			vector<int> payloads(machines);
+			vector<unsigned char> results(machines);
+			bool fleetMatches = true;
+			vector<vector<unsigned>> traces;
+			for (unsigned m = 0; m < machines; m++) traces.push_back(trace<Drydock>(streams[m]));
+			for (unsigned i = 0; i < 2000; i++)
+			{
+				//the fleet applies one event kind per pass, so each machine is stepped individually when the kinds differ
+				for (unsigned m = 0; m < machines; m++) payloads[m] = streams[m][i].payload;
+				bool sameKind = true;
+				for (unsigned m = 1; m < machines; m++) sameKind &= streams[m][i].kind == streams[0][i].kind;
+				if (sameKind) fleet.applyToAll(streams[0][i].kind, payloads.data(), results.data());
+				else for (unsigned m = 0; m < machines; m++) results[m] = fleet.apply(m, streams[m][i].kind, payloads[m]) ? Event_Accepted : Event_Rejected;
+				for (unsigned m = 0; m < machines; m++)
+				{
+					const unsigned* step = &traces[m][i * 4];
+					fleetMatches &= results[m] == step[0] && unsigned(fleet.getState(m)) == step[1]
+						&& fleet.getParamVal(m, Components) == step[2] && fleet.getParamVal(m, Energy) == step[3];
+				}
+			}
+			FSM_CHECK(fleetMatches);
+
+			//broadcast passes with a shared payload
+			DrydockFleet shared(machines);
+			shared.setVectorised(vectorised != 0);
+			Drydock single;
+			bool sharedMatches = true;
+			for (const DrydockEvent& e : stream)
+			{
+				bool accepted = single.apply(e);
+				shared.applyToAll(e.kind, e.payload, results.data());
+				for (unsigned m = 0; m < machines; m++)
+					sharedMatches &= results[m] == accepted && shared.getState(m) == single.getState() && shared.getParamVal(m, Energy) == single.getParamVal(Energy);
+			}
+			FSM_CHECK(sharedMatches);
+		}
+
+		FleetExecutor executor(machines, 4, 3);
+		for (unsigned m = 0; m < machines; m++)
+			for (const DrydockEvent& e : randomStream(2000, 100 + m)) executor.submit(m, e.kind, e.payload);
+		executor.run();
+		bool executorMatches = true;
+		for (unsigned m = 0; m < machines; m++)
+		{
+			vector<unsigned> expectedMachine = trace<Drydock>(randomStream(2000, 100 + m));
+			executorMatches &= unsigned(executor.getState(m)) == expectedMachine[expectedMachine.size() - 3]
+				&& executor.getParamVal(m, Energy) == expectedMachine[expectedMachine.size() - 1];
+		}
+		FSM_CHECK(executorMatches);
+	}
+
+	//Checks that events from several producers all reach the Drydock through the ingress
+	static void testIngress(void)
+	{
+		Drydock dock;
+		DrydockIngress ingress(&dock, 1024);
+		const unsigned producers = 4, perProducer = 5000;
+		atomic<unsigned> done(0);
+		vector<thread> threads;
+		for (unsigned p = 0; p < producers; p++)
+		{
+			threads.push_back(thread([&] {
+				for (unsigned i = 0; i < perProducer; i++)
+					while (!ingress.submit(Transfer_Energy, 1)) this_thread::yield();
+				done++;
+			}));
+		}
+		dock.supplyComponents(1);
+		unsigned applied = 0;
+		while (done < producers || applied < producers * perProducer) applied += ingress.drain();
+		for (thread& t : threads) t.join();
+		FSM_CHECK(applied == producers * perProducer);
+		FSM_CHECK(dock.getParamVal(Energy) == producers * perProducer);
+	}
+
+	//Checks that timers of any delay fire on their deadline, in the order they were scheduled, and not past a time limit
+	static void testTimerWheel(void)
+	{
+		//random delays reaching several levels of the wheel, checked against the deadlines each timer was given
+		TimerWheel<unsigned> wheel;
+		mt19937 random(3);
+		vector<unsigned long long> deadlines(500);
+		vector<unsigned> firings(500, 0);
+		for (unsigned timer = 0; timer < 500; timer++)
+		{
+			unsigned long long delay = 1 + random() % (timer % 3 == 0 ? 300000000 : 5000);
+			deadlines[timer] = delay;
+			wheel.schedule(timer, delay);
+		}
+
+		bool due = true;
+		unsigned long long fired = 0;
+		while (wheel.advance(~0ull, [&](unsigned timer) {
+			unsigned long long now = wheel.getTime();
+			due = due && deadlines[timer] == now;
+			if (++firings[timer] < 3 && timer % 2 == 0)
+			{
+				unsigned long long delay = 1 + random() % 70000;
+				deadlines[timer] = now + delay;
+				wheel.schedule(timer, delay);
+			}
+			fired++;
+		})) {}
+		FSM_CHECK(due);
+		FSM_CHECK(fired == 500 + 250 * 2);
+		FSM_CHECK(wheel.getPending() == 0);
+
+		//timers due on the same tick fire in the order they were scheduled, including after cascading down a level
+		TimerWheel<unsigned> same;
+		for (unsigned timer = 4; timer-- > 0;) same.schedule(timer, 70000);
+		vector<unsigned> order;
+		FSM_CHECK(same.advance(~0ull, [&](unsigned timer) { order.push_back(timer); }) && same.getTime() == 70000);
+		FSM_CHECK(order == vector<unsigned>({ 3, 2, 1, 0 }));
+
+		//timers far apart on the upper levels fire on their exact ticks when the time between them is jumped over
+		TimerWheel<unsigned> far;
+		vector<unsigned long long> farDeadlines = { 1ull << 62, 5, 123456789012345ull, 1ull << 40, (1ull << 40) + 1, 300 };
+		for (unsigned timer = 0; timer < farDeadlines.size(); timer++) far.schedule(timer, farDeadlines[timer]);
+		bool farDue = true;
+		unsigned farFired = 0;
+		while (far.advance(~0ull, [&](unsigned timer) { farDue = farDue && farDeadlines[timer] == far.getTime(); farFired++; })) {}
+		FSM_CHECK(farDue && farFired == farDeadlines.size());
+
+		//advancing to a limit stops there without firing later timers
+		TimerWheel<unsigned> limited;
+		limited.schedule(0, 1000);
+		unsigned limitedFired = 0;
+		FSM_CHECK(!limited.advance(999, [&](unsigned) { limitedFired++; }) && limited.getTime() == 999 && limitedFired == 0);
+		FSM_CHECK(limited.advance(2000, [&](unsigned) { limitedFired++; }) && limited.getTime() == 1000 && limitedFired == 1);
+	}
+
+	//Checks that the shipyard simulation gives the same results on the reference and table Drydocks, accounts every
+	//Drydock-tick to a state, holds no more energy than it was given, and can be run in stages
+	static void testShipyardSimulator(void)
+	{
+		ShipyardProfile profile;
+		profile.docks = 50;
+		profile.seed = 11;
+		ShipyardSimulator<Drydock> reference(profile);
+		ShipyardSimulator<TableDrydock> table(profile);
+		ShipyardReport expected = reference.run(200000);
+		ShipyardReport report = table.run(200000);
+
+		FSM_CHECK(expected.events >= 200000 && expected.launches > 0 && expected.ordersTurnedAway > 0);
+		FSM_CHECK(report.events == expected.events && report.accepted == expected.accepted && report.ticks == expected.ticks);
+		FSM_CHECK(report.launches == expected.launches && report.ordersTurnedAway == expected.ordersTurnedAway);
+
+		unsigned long long dockTicks = 0;
+		bool sameStates = true;
+		for (int i = 0; i < stateCount; i++)
+		{
+			dockTicks += expected.stateTicks[i];
+			sameStates = sameStates && report.stateTicks[i] == expected.stateTicks[i];
+		}
+		FSM_CHECK(sameStates);
+		FSM_CHECK(dockTicks == expected.ticks * profile.docks);
+		FSM_CHECK(expected.getLaunchesPerHour() == expected.launches * 3600.0 / expected.ticks);
+		for (unsigned i = 0; i < profile.docks; i++) FSM_CHECK(reference.getDock(i).getState() == table.getDock(i).getState());
+
+		//launches spend energy, so the Drydocks hold less than they accepted, and some run dry
+		unsigned long long energyHeld = 0;
+		for (unsigned i = 0; i < profile.docks; i++) energyHeld += reference.getDock(i).getParamVal(Energy);
+		FSM_CHECK(report.energyTransferred == expected.energyTransferred && energyHeld < expected.energyTransferred);
+		FSM_CHECK(expected.stateTicks[No_Energy] > 0);
+
+		//a time limit stops the run on that tick, and a later run carries on from it
+		ShipyardSimulator<TableDrydock> timed(profile);
+		FSM_CHECK(timed.run(~0ull, 3600).ticks == 3600 && timed.getTime() == 3600);
+		FSM_CHECK(timed.run(~0ull, expected.ticks).events == expected.events);
+	}
+
+	//Checks the concurrent Drydock's transitions, then that no component or energy is lost or spent twice while
+	//suppliers deposit and two builders race to reserve and launch
+	static void testConcurrentDrydock(void)
+	{
+		{
+			ConcurrentDrydock dock;
+			FSM_CHECK(dock.getState() == Out_Of_Components);
+			FSM_CHECK(!dock.supplyComponents(0) && !dock.transferEnergy(-5));
+			FSM_CHECK(dock.supplyComponents(3) && dock.getState() == No_Energy);
+			FSM_CHECK(dock.transferEnergy(11000) && dock.getState() == Has_Energy);
+			FSM_CHECK(!dock.makeSelection(1 + 128) && !dock.makeSelection(3) && !dock.launch()); //not enough energy, invalid, nothing to launch
+			FSM_CHECK(dock.makeSelection(1) && dock.getState() == Launching_Ship && dock.getLaunchingOption() == 1);
+			FSM_CHECK(dock.getParamVal(Components) == 2 && dock.getParamVal(Energy) == 0);
+			FSM_CHECK(dock.transferEnergy(20000) && !dock.makeSelection(2));
+			FSM_CHECK(dock.launch() && dock.getState() == Has_Energy && dock.getLaunchingOption() == 0);
+			FSM_CHECK(dock.makeSelection(64 + 8192) && dock.getLaunchingOption() == 64 + 8192 && dock.launch());
+			FSM_CHECK(dock.getState() == Out_Of_Components && dock.getParamVal(Energy) == 20000 - 14000);
+		}
+
+		{
+			//deposits that would overflow the packed word are refused, and a build makes room for more
+			ConcurrentDrydock dock;
+			FSM_CHECK(dock.supplyComponents(0xFFFFFF - 1) && dock.supplyComponents(1) && !dock.supplyComponents(1));
+			FSM_CHECK(dock.transferEnergy(0x7FFFFFFF) && dock.transferEnergy(0x7FFFFFFF) && dock.transferEnergy(1));
+			FSM_CHECK(!dock.transferEnergy(1) && !dock.transferEnergy(0x7FFFFFFF));
+			FSM_CHECK(dock.getParamVal(Components) == 0xFFFFFF && dock.getParamVal(Energy) == 0xFFFFFFFFu);
+			FSM_CHECK(dock.makeSelection(1) && dock.getParamVal(Components) == 0xFFFFFF - 1 && dock.getParamVal(Energy) == 0xFFFFFFFFu - 11000);
+			FSM_CHECK(dock.supplyComponents(1) && !dock.supplyComponents(1) && dock.transferEnergy(11000) && !dock.transferEnergy(1));
+			FSM_CHECK(dock.launch() && dock.getParamVal(Components) == 0xFFFFFF && dock.getParamVal(Energy) == 0xFFFFFFFFu);
+		}
+
+		ConcurrentDrydock dock;
+		const unsigned suppliers = 4, perSupplier = 20000;
+		atomic<unsigned> done(0), building(0);
+		atomic<unsigned long long> componentsUsed(0), energyUsed(0);
+		vector<thread> threads;
+		for (unsigned p = 0; p < suppliers; p++)
+		{
+			threads.push_back(thread([&] {
+				while (building < 2) this_thread::yield();
+				for (unsigned i = 0; i < perSupplier; i++)
+				{
+					dock.transferEnergy(1000);
+					if (i % 4 == 0) dock.supplyComponents(1);
+				}
+				done++;
+			}));
+		}
+		for (int builder = 0; builder < 2; builder++)
+		{
+			threads.push_back(thread([&, builder] {
+				const int option = builder ? 1 : 1 + 128;
+				OptionCost selection = decodeOption(option);
+				building++;
+				while (true)
+				{
+					//keep building after the suppliers finish, until a reservation is refused
+					bool supplied = done == suppliers;
+					if (dock.makeSelection(option))
+					{
+						componentsUsed += selection.componentsNeeded;
+						energyUsed += selection.cost;
+					}
+					else if (supplied) break;
+					dock.launch();
+				}
+			}));
+		}
+		for (thread& t : threads) t.join();
+		dock.launch();
+
+		FSM_CHECK(componentsUsed > 0);
+		FSM_CHECK(dock.getParamVal(Components) + componentsUsed == suppliers * perSupplier / 4);
+		FSM_CHECK(dock.getParamVal(Energy) + energyUsed == 1000ull * suppliers * perSupplier);
+	}
+
+#if FSM_COROUTINES
+	//Workflow that supplies, builds and launches a ship on each cycle, recording the tick of every launch
+	//Parametres:
+		//(dock) Drydock to build on
+		//(loop) event loop the workflow runs on
+		//(cycles) number of build cycles
+		//(launchTimes) receives the tick of each launch
+	static DrydockTask buildShips(AsyncDrydock& dock, EventLoop& loop, unsigned cycles, vector<unsigned long long>& launchTimes)
+	{
+		for (unsigned i = 0; i < cycles; i++)
+		{
+			dock.supplyComponents(10);
+			dock.transferEnergy(40000);
+			if (!co_await dock.build(1 + 128)) continue;
+			ShipHandle ship = co_await dock.launch();
+			if (ship) launchTimes.push_back(loop.getTime());
+		}
+	}
+
+	//Workflow whose build and launch the Drydock rejects
+	//Parametres:
+		//(dock) Drydock without components
+		//(loop) event loop the workflow runs on
+		//(finishedAt) receives the tick the workflow finished on, or stays at its value if it did not finish
+	static DrydockTask rejectedShips(AsyncDrydock& dock, EventLoop& loop, unsigned long long& finishedAt)
+	{
+		bool built = co_await dock.build(1);
+		ShipHandle ship = co_await dock.launch();
+		if (!built && !ship) finishedAt = loop.getTime();
+	}
+
+	//Counts the destruction of the coroutine frame it lives in
+	struct FrameGuard
+	{
+		unsigned& destroyed;
+		~FrameGuard(void) { this->destroyed++; }
+	};
+
+	//Workflow that sleeps, counting when its frame is destroyed
+	//Parametres:
+		//(loop) event loop the workflow runs on
+		//(ticks) ticks to sleep
+		//(destroyed) incremented when the frame is destroyed
+	static DrydockTask guardedSleep(EventLoop& loop, unsigned long long ticks, unsigned& destroyed)
+	{
+		FrameGuard guard{ destroyed };
+		co_await loop.sleep(ticks);
+	}
+
+	//Checks that builds and launches take their simulated time on many Drydocks at once, and rejected ones none
+	static void testAsyncDrydock(void)
+	{
+		EventLoop loop;
+		const unsigned docks = 1000, cycles = 4;
+		vector<AsyncDrydock*> yard;
+		vector<vector<unsigned long long>> launchTimes(docks);
+		for (unsigned i = 0; i < docks; i++)
+		{
+			yard.push_back(new AsyncDrydock(loop, 60 + i % 3, 10));
+			loop.spawn(buildShips(*yard[i], loop, cycles, launchTimes[i]));
+		}
+		AsyncDrydock empty(loop);
+		unsigned long long rejectedAt = 12345;
+		loop.spawn(rejectedShips(empty, loop, rejectedAt));
+
+		FSM_CHECK(loop.run() == cycles * (62 + 10));
+		FSM_CHECK(loop.getLiveTasks() == 0 && loop.getPeakTasks() == docks + 1);
+		FSM_CHECK(rejectedAt == 0);
+		for (unsigned i = 0; i < docks; i++)
+		{
+			FSM_CHECK(launchTimes[i].size() == cycles);
+			for (unsigned c = 0; c < launchTimes[i].size(); c++) FSM_CHECK(launchTimes[i][c] == (c + 1) * (60 + i % 3 + 10));
+			FSM_CHECK(yard[i]->getDrydock().getState() == Has_Energy);
+			delete yard[i];
+		}
+
+		//long sleeps are jumped over rather than stepped through, so even one of 10^12 ticks takes no noticeable time
+		EventLoop sparse;
+		unsigned sparseDone = 0;
+		sparse.spawn(guardedSleep(sparse, 1000000000000ull, sparseDone));
+		sparse.spawn(guardedSleep(sparse, 100 + 64 * 3, sparseDone));
+		chrono::steady_clock::time_point sparseStart = chrono::steady_clock::now();
+		FSM_CHECK(sparse.run(1000) == 1000 && sparseDone == 1 && sparse.getLiveTasks() == 1);
+		FSM_CHECK(sparse.run() == 1000000000000ull && sparseDone == 2 && sparse.getResumes() == 4);
+		FSM_CHECK(chrono::steady_clock::now() - sparseStart < chrono::milliseconds(100));
+
+		//a loop destroyed with tasks in flight destroys their frames (the last task never starts, so it has no guard to count)
+		unsigned destroyed = 0;
+		{
+			EventLoop unfinished;
+			AsyncDrydock dock(unfinished);
+			vector<unsigned long long> times;
+			unfinished.spawn(buildShips(dock, unfinished, 2, times));
+			unfinished.spawn(guardedSleep(unfinished, 10, destroyed));
+			unfinished.spawn(guardedSleep(unfinished, 1000, destroyed));
+			FSM_CHECK(unfinished.run(100) == 100 && unfinished.getLiveTasks() == 2 && destroyed == 1 && times.size() == 1);
+			unfinished.spawn(guardedSleep(unfinished, 10, destroyed));
+		}
+		FSM_CHECK(destroyed == 2);
+	}
+#endif
+
+	//Checks planned builds against an exhaustive search on small order books, then executes each plan on a Drydock
+	static void testPlanner(void)
+	{
+		const int options[] = { 1, 2, 8, 64, 1 + 128, 2 + 256, 64 + 8192, 3, 128 };
+		mt19937 random(7);
+		for (int round = 0; round < 500; round++)
+		{
+			vector<int> demand(random() % 11);
+			for (int& option : demand) option = options[random() % (sizeof(options) / sizeof(options[0]))];
+			unsigned components = random() % 8, energy = random() % 60000;
+			BuildPlan plan = Drydock::planBuilds(components, energy, demand.data(), unsigned(demand.size()));
+
+			size_t best = 0;
+			for (unsigned mask = 0; mask < (1u << demand.size()); mask++)
+			{
+				unsigned long long usedComponents = 0, usedEnergy = 0;
+				size_t launches = 0;
+				bool valid = true;
+				for (size_t i = 0; i < demand.size(); i++)
+				{
+					if (!(mask & (1u << i))) continue;
+					OptionCost selection = decodeOption(demand[i]);
+					valid &= selection.valid;
+					usedComponents += selection.componentsNeeded;
+					usedEnergy += selection.cost;
+					launches++;
+				}
+				if (valid && usedComponents <= components && usedEnergy <= energy) best = max(best, launches);
+			}
+			FSM_CHECK(plan.options.size() == best && plan.componentsUsed <= components && plan.energyUsed <= energy);
+			if (components == 0 || energy == 0) continue;
+
+			//every planned order is built and launched, using up exactly the planned resources
+			Drydock dock;
+			dock.supplyComponents(components);
+			dock.transferEnergy(energy);
+			BuildPlan docked = dock.planBuilds(demand);
+			vector<ShipHandle> ships;
+			DrydockBatchResult result = dock.executePlan(docked, &ships);
+			FSM_CHECK(docked.options == plan.options);
+			FSM_CHECK(result.results.size() == 2 * plan.options.size() && ships.size() == plan.options.size());
+			FSM_CHECK(count(result.results.begin(), result.results.end(), Event_Accepted) == long(result.results.size()));
+			if (plan.componentsUsed == components) FSM_CHECK(result.finalState == Out_Of_Components && result.components == 0 && result.energy == 0);
+			else FSM_CHECK(result.components == components - plan.componentsUsed && result.energy == energy - plan.energyUsed);
+		}
+
+		//a large budget, which used to leave the Drydock without energy part way through the plan
+		Drydock dock;
+		dock.supplyComponents(20000);
+		dock.transferEnergy(22000);
+		vector<int> demand = { 1, 2, 1 + 128, 4 };
+		BuildPlan plan = dock.planBuilds(demand);
+		vector<ShipHandle> ships;
+		DrydockBatchResult result = dock.executePlan(plan, &ships);
+		FSM_CHECK(plan.options == vector<int>({ 1 }) && ships.size() == 1 && ships[0]->getCost() == decodeOption(1).cost);
+		FSM_CHECK(result.finalState == Has_Energy && result.components == 19999 && result.energy == 22000 - 11000);
+
+		//a Drydock that cannot take a selection plans nothing, and a plan it cannot follow stops at the first rejection
+		FSM_CHECK(Drydock().planBuilds(demand).options.empty());
+		Drydock unpowered;
+		unpowered.supplyComponents(5);
+		result = unpowered.executePlan(Drydock::planBuilds(5, 50000, demand.data(), unsigned(demand.size())));
+		FSM_CHECK(result.results == vector<unsigned char>({ Event_Rejected }) && result.finalState == No_Energy);
+	}
+
+	//Checks that a Drydock recovered from its journal and snapshots matches the live Drydock
+	static void testJournalRecovery(void)
+	{
+		const char* journalPath = "fsm_tests.journal";
+		const char* snapshotPath = "fsm_tests.snapshot";
+		remove(journalPath);
+		remove(snapshotPath);
+
+		vector<DrydockEvent> stream = randomStream(5000, 3);
+		DrydockSnapshot expected;
+		{
+			Drydock dock;
+			DrydockJournal* journal = new DrydockJournal(journalPath, 64, 16);
+			journal->setSnapshots(snapshotPath, 777);
+			dock.setJournal(journal);
+			for (size_t i = 0; i < stream.size(); i++)
+			{
+				dock.apply(stream[i]);
+				if (i % 3 == 0) dock.undockShip();
+			}
+
+			//rejected kinds are not journalled, so one that collides with a journal kind is not replayed as an undock
+			vector<DrydockEvent> invalid = { { event(Undock_Ship), 0 }, { event(-1), 0 } };
+			dock.processEvents(invalid);
+			expected = dock.snapshot();
+		}
+
+		vector<JournalRecord> records;
+		FSM_CHECK(DrydockJournal::load(journalPath, records));
+		FSM_CHECK(records.size() == stream.size() + (stream.size() + 2) / 3);
+
+		Drydock recovered;
+		FSM_CHECK(recovered.recover(journalPath, snapshotPath));
+		DrydockSnapshot result = recovered.snapshot();
+		FSM_CHECK(result.stateIndex == expected.stateIndex && result.components == expected.components && result.energy == expected.energy);
+		FSM_CHECK(result.launchingOption == expected.launchingOption && result.shipLaunching == expected.shipLaunching);
+
+		//a corrupted snapshot is refused rather than indexing past the states or decoding an invalid option
+		DrydockSnapshot corrupt = result;
+		corrupt.stateIndex = stateCount;
+		FSM_CHECK(!recovered.restore(corrupt));
+		corrupt = result;
+		corrupt.launchingOption = 3;
+		FSM_CHECK(!recovered.restore(corrupt));
+		FSM_CHECK(recovered.getState() == result.stateIndex && recovered.getParamVal(Energy) == result.energy);
+
+		corrupt = result;
+		corrupt.journalRecords = records.size();
+		corrupt.stateIndex = 255;
+		ofstream(snapshotPath, ios::binary | ios::app).write((const char*)&corrupt, sizeof(corrupt));
+		Drydock untouched;
+		FSM_CHECK(!untouched.recover(journalPath, snapshotPath));
+		FSM_CHECK(untouched.getState() == Out_Of_Components && untouched.getParamVal(Components) == 0);
+
+		remove(journalPath);
+		remove(snapshotPath);
+	}
+
+	//Checks that diagnostics reach a sink as the text the states used to print
+	static void testDiagnostics(void)
+	{
+		Drydock dock;
+		BufferedTextSink* sink = new BufferedTextSink;
+		dock.setDiagnostics(sink);
+		dock.transferEnergy(5);
+		ostringstream text;
+		sink->flush(text);
+		FSM_CHECK(text.str() == "ERROR: cannot accept energy due to the absence of components\n");
+
+		//a ring buffer sink writes out every record it accepted before it was destroyed, however late they arrive
+		bool complete = true;
+		for (int round = 0; round < 200; round++)
+		{
+			const int records = round % 2 ? 1 : 100;
+			ostringstream binary;
+			size_t dropped;
+			{
+				RingBufferSink ring(binary, 128);
+				this_thread::sleep_for(chrono::microseconds(round % 4 * 300)); //catch the drain thread at different points of its poll
+				for (int i = 0; i < records; i++) ring.write({ Components_Added, i, round });
+				dropped = ring.getDropped();
+			}
+			complete = complete && dropped == 0 && binary.str().size() == records * sizeof(Diagnostic);
+		}
+		FSM_CHECK(complete);
+	}
+
+	//Checks InputReader's parsing, line endings, overlong lines and end of input
+	static void testInputReader(void)
+	{
+		const char* path = "drydock_tests.input";
+		{
+			ofstream file(path, ios::binary);
+			file << "42\n  -7 \r\n2147483648\n12x\n\n" << string(100000, '9') << "\n5\nYES\r\nmaybe\nn\n9";
+		}
+#ifdef _WIN32
+		int descriptor = _open(path, _O_RDONLY | _O_BINARY);
+#else
+		int descriptor = open(path, O_RDONLY);
+#endif
+		{
+			InputReader reader(descriptor);
+			int value = 0;
+			bool isYes = false;
+			FSM_CHECK(reader.readInteger(value) == Input_Valid && value == 42);
+			FSM_CHECK(reader.readInteger(value, -10, 10) == Input_Valid && value == -7);
+			FSM_CHECK(reader.readInteger(value) == Input_Invalid); //out of int range
+			FSM_CHECK(reader.readInteger(value) == Input_Invalid);
+			FSM_CHECK(reader.readInteger(value) == Input_Invalid); //empty line
+			FSM_CHECK(reader.readInteger(value) == Input_Invalid); //longer than the buffer, read as one line
+			FSM_CHECK(reader.readInteger(value, 1, 4) == Input_Invalid && value == -7);
+			FSM_CHECK(reader.readYesNo(isYes) == Input_Valid && isYes);
+			FSM_CHECK(reader.readYesNo(isYes) == Input_Invalid);
+			FSM_CHECK(reader.readYesNo(isYes) == Input_Valid && !isYes);
+			FSM_CHECK(reader.readInteger(value) == Input_Valid && value == 9 && !reader.hasEnded()); //last line without a line ending
+			FSM_CHECK(reader.readInteger(value) == Input_End && reader.hasEnded());
+			FSM_CHECK(reader.readYesNo(isYes) == Input_End);
+		}
+#ifdef _WIN32
+		_close(descriptor);
+#else
+		close(descriptor);
+#endif
+		remove(path);
+	}
+
+	//State that counts how often its hooks fire
+	class CountingState : public State
+	{
+	public:
+		unsigned entered = 0;
+		unsigned left = 0;
+		CountingState(StateContext* context) : State(context) {}
+		void transition(void) { this->entered++; }
+		void leave(void) { this->left++; }
+	};
+
+	//Context with two CountingStates, starting in the first
+	class CountingContext : public StateContext
+	{
+	public:
+		CountingContext(void)
+		{
+			this->availableStates[0] = new CountingState(this);
+			this->availableStates[1] = new CountingState(this);
+			this->setState(state(0));
+		}
+		CountingState* hooks(int index) { return (CountingState*)this->availableStates[index]; }
+	};
+
+	//Checks that same-state transitions are counted and only fire the hooks in Every_Transition mode
+	static void testTransitionModes(void)
+	{
+		for (transitionMode mode : { Every_Transition, State_Changes_Only })
+		{
+			CountingContext context;
+			context.setTransitionMode(mode);
+			context.setState(state(0));
+			context.setState(state(1));
+			context.setState(state(1));
+			context.setState(state(1));
+			context.setState(state(0));
+
+			unsigned repeats = mode == Every_Transition ? 1 : 0;
+			FSM_CHECK(context.getState() == state(0));
+			FSM_CHECK(context.getTransitionCount() == 6 && context.getRedundantTransitions() == 3);
+			FSM_CHECK(context.hooks(0)->entered == 2 + repeats && context.hooks(0)->left == 1 + repeats);
+			FSM_CHECK(context.hooks(1)->entered == 1 + 2 * repeats && context.hooks(1)->left == 1 + 2 * repeats);
+		}
+
+		//the rejection paths keep the state without changing the results
+		vector<DrydockEvent> stream = randomStream(2000, 7);
+		Drydock every, changesOnly;
+		changesOnly.setTransitionMode(State_Changes_Only);
+		for (const DrydockEvent& e : stream) FSM_CHECK(every.apply(e) == changesOnly.apply(e) && every.getState() == changesOnly.getState());
+		FSM_CHECK(every.getRedundantTransitions() > 0 && every.getRedundantTransitions() == changesOnly.getRedundantTransitions());
+
+		//the transition table engine counts the same transitions as the State methods
+		Drydock batch;
+		TableDrydock table;
+		batch.processEvents(stream);
+		for (const DrydockEvent& e : stream) table.apply(e);
+		FSM_CHECK(batch.getTransitionCount() == every.getTransitionCount() && batch.getRedundantTransitions() == every.getRedundantTransitions());
+		FSM_CHECK(table.getTransitionCount() == every.getTransitionCount() && table.getRedundantTransitions() == every.getRedundantTransitions());
+	}
+
+#if FSM_INSTRUMENTATION
+	//Checks the transition counters, including those of a thread that has exited
+	static void testInstrumentation(void)
+	{
+		TransitionMetrics::reset();
+		{
+			Drydock dock;
+			dock.supplyComponents(3);
+			dock.transferEnergy(20000);
+			dock.makeSelection(3);
+			dock.makeSelection(1 + 128);
+			dock.launch();
+		}
+		thread worker([] {
+			TableDrydock dock;
+			for (int i = 0; i < 1000; i++) dock.transferEnergy(5);
+		});
+		worker.join();
+
+		TransitionStats stats = TransitionMetrics::snapshot();
+		FSM_CHECK(stats.getCount(Out_Of_Components, Supply_Components, No_Energy) == 1);
+		FSM_CHECK(stats.getCount(No_Energy, Transfer_Energy, Has_Energy) == 1);
+		FSM_CHECK(stats.getCount(Has_Energy, Make_Selection, Has_Energy) == 1);
+		FSM_CHECK(stats.getCount(Has_Energy, Make_Selection, Launching_Ship) == 1);
+		FSM_CHECK(stats.getCount(Launching_Ship, Launch_Ship, Has_Energy) == 1);
+		FSM_CHECK(stats.accepted[Has_Energy][Make_Selection] == 1 && stats.rejected[Has_Energy][Make_Selection] == 1);
+		FSM_CHECK(stats.getCount(Out_Of_Components, Transfer_Energy, Out_Of_Components) == 1000);
+		FSM_CHECK(stats.stateChanges[Has_Energy][Has_Energy] == 1 && stats.stateChanges[Out_Of_Components][No_Energy] == 1);
+
+		unsigned long long sampled = 0;
+		for (int b = 0; b < LatencyHistogram::bucketCount; b++) sampled += stats.latency[Out_Of_Components][Transfer_Energy].counts[b];
+		//a new thread times its first event, then waits between half and one and a half sampling periods per timed event
+		FSM_CHECK(sampled >= 1 + 999 / (FSM_LATENCY_SAMPLING + FSM_LATENCY_SAMPLING / 2) && sampled <= 1 + 999 / (FSM_LATENCY_SAMPLING / 2 + 1));
+		FSM_CHECK(stats.getLatency(Out_Of_Components, Transfer_Energy, 0.5) > 0);
+
+		for (unsigned long long value : { 0ull, 7ull, 8ull, 15ull, 16ull, 1000ull, 123456789ull })
+			FSM_CHECK(value <= LatencyHistogram::upperBound(LatencyHistogram::bucketOf(value)) && (value < 8 || LatencyHistogram::upperBound(LatencyHistogram::bucketOf(value)) < value + value / 8 + 1));
+	}
+#endif
+public:
+	//Records the result of one check
+	//Parametres:
+		//(passed) result of the check
+		//(expression) source text of the check
+		//(file) source file of the check
+		//(line) source line of the check
+	static void check(bool passed, const char* expression, const char* file, int line)
+	{
+		if (passed) return;
+		failures()++;
+		cerr << file << ":" << line << ": check failed: " << expression << endl;
+	}
+
+	//Runs every test and returns the number of failed checks
+	static unsigned run(void)
+	{
+		testReferenceTransitions();
+		testCatalog();
+		testEngineEquivalence();
+		testIngress();
+		testConcurrentDrydock();
+		testTimerWheel();
+		testShipyardSimulator();
+#if FSM_COROUTINES
+		testAsyncDrydock();
+#endif
+		testPlanner();
+		testJournalRecovery();
+		testDiagnostics();
+		testTransitionModes();
+		testInputReader();
+#if FSM_INSTRUMENTATION
+		testInstrumentation();
+#endif
+		return failures();
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	unsigned failed = DrydockTests::run();
+	cout << (failed ? "FAILED: " : "All tests passed") << (failed ? to_string(failed) + " checks" : "") << endl;
+	return failed ? 1 : 0;
+}
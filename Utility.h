@@ -10,8 +10,21 @@
 #include <string>
 #include <sstream>
 #include <random>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <charconv>
+#include <string_view>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 #include <conio.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -19,78 +32,248 @@ using namespace std;
 enum Colour { BLACK, BLUE, GREEN, AQUA, RED, PURPLE, YELLOW, DEFAULT, GRAY, LIGHT_BLUE,
 	LIGHT_GREEN, LIGHT_AQUA, LIGHT_RED, LIGHT_PURPLE, LIGHT_YELLOW, WHITE };
 
+//Possible results of reading a value from an InputReader
+	//(Input_Valid) a value was read
+	//(Input_Invalid) the line did not hold a value of the requested kind
+	//(Input_End) the input has ended
+enum inputResult { Input_Valid, Input_Invalid, Input_End };
+
+//Buffered line reader for console input
+//Reads straight from a file descriptor into one large buffer and parses each line in place with from_chars,
+//so piping a long script of answers into the UI costs no allocation or locale lookup per line
+class InputReader
+{
+private:
+	static const size_t bufferSize = 65536;
+	char* buffer;
+	size_t start = 0; //first unread byte
+	size_t filled = 0; //bytes held in the buffer
+	int descriptor;
+	bool exhausted = false; //the descriptor has no more to read
+	bool ended = false; //a read found no line left
+	bool discarding = false; //skipping the rest of a line longer than the buffer
+
+	//Moves the unread bytes to the front of the buffer and reads more after them
+	//Returns false if the descriptor has no more to read
+	bool refill(void)
+	{
+		if (this->exhausted) return false;
+		cout.flush(); //show any prompt before blocking on input
+		memmove(this->buffer, this->buffer + this->start, this->filled - this->start);
+		this->filled -= this->start;
+		this->start = 0;
+
+		long long count;
+		do
+		{
+#ifdef _WIN32
+			count = _read(this->descriptor, this->buffer + this->filled, unsigned(bufferSize - this->filled));
+#else
+			count = (long long)::read(this->descriptor, this->buffer + this->filled, bufferSize - this->filled);
+#endif
+		} while (count < 0 && errno == EINTR);
+		if (count <= 0)
+		{
+			this->exhausted = true;
+			return false;
+		}
+		this->filled += size_t(count);
+		return true;
+	}
+
+	//Narrows a token to its first and last non-blank characters
+	//Parametres:
+		//(first) first character of the token
+		//(last) one past the last character of the token
+	static void trim(const char*& first, const char*& last)
+	{
+		while (first < last && (*first == ' ' || *first == '\t')) first++;
+		while (last > first && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r')) last--;
+	}
+public:
+	//Creates a reader over an open file descriptor
+	//Parametres:
+		//(nDescriptor) descriptor to read from (defaulted as standard input)
+	InputReader(int nDescriptor = 0)
+	{
+		this->buffer = new char[bufferSize];
+		this->descriptor = nDescriptor;
+	}
+	~InputReader(void) { delete[] this->buffer; }
+	InputReader(const InputReader&) = delete;
+	InputReader& operator=(const InputReader&) = delete;
+
+	//Returns the next line without its line ending, or false once the input has ended
+	//The line stays valid until the next read; a line longer than the buffer is cut short
+	//Parametres:
+		//(line) set to the first character of the line
+		//(length) set to the length of the line
+	bool nextLine(const char*& line, size_t& length)
+	{
+		while (true)
+		{
+			const char* data = this->buffer + this->start;
+			size_t available = this->filled - this->start;
+			const char* newline = (const char*)memchr(data, '\n', available);
+			if (newline)
+			{
+				length = size_t(newline - data);
+				this->start += length + 1;
+				if (this->discarding)
+				{
+					this->discarding = false;
+					continue;
+				}
+				line = data;
+				return true;
+			}
+			if (available == bufferSize)
+			{
+				this->start = this->filled;
+				if (this->discarding) continue;
+				this->discarding = true;
+				line = data;
+				length = available;
+				return true;
+			}
+			if (this->refill()) continue;
+
+			//the input ends without a line ending after its last line
+			data = this->buffer + this->start;
+			available = this->filled - this->start;
+			this->start = this->filled;
+			if (available == 0 || this->discarding)
+			{
+				this->ended = true;
+				return false;
+			}
+			line = data;
+			length = available;
+			return true;
+		}
+	}
+
+	//Reads a line holding a whole number between min and max
+	//Parametres:
+		//(value) set to the number read
+		//(min) minimum bound accepted from input
+		//(max) maximum bound accepted from input
+	inputResult readInteger(int& value, int min = -2147483647 - 1, int max = 2147483647)
+	{
+		const char* line;
+		size_t length;
+		if (!this->nextLine(line, length)) return Input_End;
+
+		const char* first = line;
+		const char* last = line + length;
+		trim(first, last);
+		int parsed = 0;
+		from_chars_result result = from_chars(first, last, parsed);
+		if (result.ec != errc() || result.ptr != last || parsed < min || parsed > max) return Input_Invalid;
+		value = parsed;
+		return Input_Valid;
+	}
+
+	//Reads a line holding a yes/no response ('Yes', 'No' or a similar variation)
+	//Parametres:
+		//(isYes) set to whether the response was a yes
+	inputResult readYesNo(bool& isYes)
+	{
+		static const string_view yes[] = { "Y", "Yes", "YES", "yes", "y" };
+		static const string_view no[] = { "N", "No", "NO", "no", "n" };
+
+		const char* line;
+		size_t length;
+		if (!this->nextLine(line, length)) return Input_End;
+
+		const char* first = line;
+		const char* last = line + length;
+		trim(first, last);
+		string_view token(first, size_t(last - first));
+		for (const string_view& word : yes) if (token == word) { isYes = true; return Input_Valid; }
+		for (const string_view& word : no) if (token == word) { isYes = false; return Input_Valid; }
+		return Input_Invalid;
+	}
+
+	//Returns whether a read has found the input ended
+	bool hasEnded(void) { return this->ended; }
+};
+
 class Utility
 {
 private:
 	Utility() {}; //prevents class from being constructed
 	~Utility() {};
 public:	
+	//Returns the reader all console input goes through
+	static InputReader& input(void)
+	{
+		static InputReader reader;
+		return reader;
+	}
+
 	//Requests a yes/no (or similar varied) response from the user
+	//Returns false if the input has ended (see inputEnded())
 	//Parametres:
 		//(mssage) prompt message for request
-	static bool getYesNo(string message)
+	static bool getYesNo(const char* message)
 	{
-		string input = "";
-		bool isYes = true;
+		bool isYes = false;
+		inputResult result;
 
 		cout << message;
-		cin >> input;
-		cin.ignore();
-		while (input != "Y" && input != "Yes" && input != "YES" && input != "yes" && input != "N" && input != "No" && input != "NO" && input != "no" && input != "y" && input != "n")
-		{
+		while ((result = input().readYesNo(isYes)) == Input_Invalid)
 			cout << "ERROR: you can only enter 'Yes', 'No' or a similar variation.\nTry again: ";
-			cin >> input;
-		}
-
-		if (input == "Y" || input == "Yes" || input == "YES" || input == "yes" || input == "y")
-			isYes = true;
-		else if (input == "N" || input == "No" || input == "NO" || input == "no" || input == "n")
-			isYes = false;
-		return isYes;
+		return result == Input_Valid && isYes;
 	}
 
 	//Requests an integer value from the user
+	//Returns min if the input has ended (see inputEnded())
 	//Parametres:
 		//(message) prompt message for request
 		//(min) minimum bound accepted from input (defaulted as minimum int value)
 		//(max) maximum bound accepted from input (defaulted as maximum int value)
-	static int getInteger(string message, int min = -2147483647, int max = 2147483647)
+	static int getInteger(const char* message, int min = -2147483647, int max = 2147483647)
 	{
-		string input = "";
-		int processedInput = -2147483647;
+		int processedInput = min;
+		inputResult result;
 
 		cout << message;
-		cin >> input;
-		cin.ignore();
-		stringstream strStream(input);
-		strStream >> processedInput;
-		while (processedInput < min || processedInput > max)
-		{
+		while ((result = input().readInteger(processedInput, min, max)) == Input_Invalid)
 			cout << "ERROR: you can only enter a whole number between " << min << " and " << max << ".\nTry again: ";
-			cin >> input;
-			cin.ignore();
-			stringstream strStream(input);
-			strStream >> processedInput;
-		}
-		return processedInput;
+		return result == Input_Valid ? processedInput : min;
 	}
 
+	//Returns whether the console input has ended, after which getInteger() and getYesNo() return at once
+	static bool inputEnded(void) { return input().hasEnded(); }
+
 	//Clears the console output screen
+#ifdef _WIN32
 	static void clearScreen(void) { system("cls"); }
+#else
+	static void clearScreen(void) { cout << "\033[2J\033[H" << flush; }
+#endif
 
 	//Changes the console window's title
 	//Parametres:
 		//(nTitle) desired new console window title
+#ifdef _WIN32
 	static void setWindowTitle(string nTitle) { SetConsoleTitle(nTitle.c_str()); }
+#else
+	static void setWindowTitle(string nTitle) { cout << "\033]0;" << nTitle << "\007" << flush; }
+#endif
 
 	//Changes the console output's colour
 	//Parametres:
 		//(fore) desired enumerated foreground (text) colour
 		//(back) desired enumerated background colour (defaulted as black)
+	//Only supported on Windows consoles; elsewhere the terminal's own colours are kept
 	static void setColour(Colour fore, Colour back = BLACK)
 	{
+#ifdef _WIN32
 		HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
 		int colour = fore * 16 + back;
 		SetConsoleTextAttribute(handle, back);
+#endif
 	}
 };
\ No newline at end of file